@@ -0,0 +1,288 @@
+#include "harness.hpp"
+#include "output.hpp"
+#include "renderer.hpp"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#ifndef LV_BUILD_TYPE
+#define LV_BUILD_TYPE "unknown"
+#endif
+
+// benchmark suite of the hot paths: simulation steps, energy, CSV export, compression and rendering.
+// usage: bench [--repetitions N] [--filter substring] [--output file.json]
+namespace {
+using lotka_volterra::Integrator;
+using lotka_volterra::Simulation;
+
+Simulation make_simulation(double dt, Integrator method = Integrator::Euler)
+{
+  return Simulation{dt, 1., 1., 1., 1., 1.5, 1.5, method};
+}
+
+// a run stopped by the stability check would report a meaningless throughput
+void check_completed(Simulation const& sim)
+{
+  if (sim.isUnstable()) {
+    throw std::runtime_error("benchmark run aborted by the stability check.");
+  }
+  bench::keep(sim.H());
+}
+
+std::string format(double value)
+{
+  std::ostringstream os;
+  os << value;
+  return os.str();
+}
+
+std::string build_info()
+{
+  std::string info = "{\"compiler\": \"" __VERSION__ "\", \"build_type\": \"" LV_BUILD_TYPE "\", \"assertions\": ";
+#ifdef NDEBUG
+  info += "false}";
+#else
+  info += "true}";
+#endif
+  return info;
+}
+
+void bench_simulation(bench::Harness& h)
+{
+  constexpr std::size_t steps = 1000000; // same length for both paths, so the columns grow the same way
+
+  struct Case
+  {
+    char const* name;
+    Integrator method;
+    double dt;
+  };
+  Case const cases[] = {{"euler", Integrator::Euler, 0.0001},    {"euler", Integrator::Euler, 0.001},
+                        {"heun", Integrator::Heun, 0.01},        {"rk4", Integrator::RK4, 0.01},
+                        {"rk4", Integrator::RK4, 0.1},           {"strang", Integrator::Strang, 0.01},
+                        {"strang", Integrator::Strang, 0.1},     {"yoshida", Integrator::Yoshida, 0.01},
+                        {"dormand_prince", Integrator::DormandPrince, 0.01}};
+
+  for (Case const& c : cases) {
+    std::string const suffix = std::string{"/"} + c.name + "/dt=" + format(c.dt);
+
+    h.run("evolve" + suffix, steps, 0., [&c] { return make_simulation(c.dt, c.method); },
+          [](Simulation& sim) {
+            for (std::size_t i = 0; i < steps; ++i) {
+              sim.evolve();
+            }
+            check_completed(sim);
+          });
+
+    h.run("evolveSteps" + suffix, steps, 0., [&c] { return make_simulation(c.dt, c.method); },
+          [](Simulation& sim) {
+            sim.evolveSteps(steps);
+            check_completed(sim);
+          });
+  }
+
+  h.run("evolveSteps/euler/dt=0.0001/history=1024", steps, 0.,
+        [] {
+          Simulation sim = make_simulation(0.0001);
+          sim.setHistory(1024);
+          return sim;
+        },
+        [](Simulation& sim) {
+          sim.evolveSteps(steps);
+          check_completed(sim);
+        });
+
+  h.run("evolveSteps/euler/dt=0.0001/compressed=65536", steps, 0.,
+        [] {
+          Simulation sim = make_simulation(0.0001);
+          sim.setCompressedHistory(65536);
+          return sim;
+        },
+        [](Simulation& sim) {
+          sim.evolveSteps(steps);
+          check_completed(sim);
+        });
+}
+
+// compute_H is private: it is energy() plus the stability flag, so energy() is measured
+void bench_energy(bench::Harness& h)
+{
+  constexpr std::size_t evaluations = 1000000;
+
+  Simulation sim = make_simulation(0.0001);
+  sim.evolveSteps(evaluations - 1);
+
+  h.run("energy", evaluations, 0., [] { return 0.; },
+        [&sim](double& sum) {
+          std::span<double const> const xs = sim.xs();
+          std::span<double const> const ys = sim.ys();
+          for (std::size_t i = 0; i < xs.size(); ++i) {
+            sum += sim.energy(xs[i], ys[i]);
+          }
+          bench::keep(sum);
+        });
+}
+
+void bench_csv(bench::Harness& h)
+{
+  constexpr std::size_t rows = 1000000;
+  std::string const path     = "bench_trajectory.csv";
+
+  Simulation sim = make_simulation(0.0001);
+  sim.evolveSteps(rows - 1);
+
+  for (int precision : {6, 0}) {
+    for (std::size_t threads : {std::size_t{1}, std::size_t{4}}) {
+      std::string const name = "outputCSV/rows=" + std::to_string(rows) + "/precision=" + std::to_string(precision)
+                             + "/threads=" + std::to_string(threads);
+      if (!h.enabled(name)) {
+        continue;
+      }
+
+      io::CSVOptions options;
+      options.precision = precision;
+      options.threads   = threads;
+      io::outputCSV(sim, path, options);
+      double const bytes = static_cast<double>(std::filesystem::file_size(path));
+
+      h.run(name, rows, bytes, [] { return 0; }, [&sim, &path, &options](int&) { io::outputCSV(sim, path, options); });
+    }
+  }
+  std::filesystem::remove(path);
+}
+
+// encoding and decoding of a whole trajectory by the lossless and the lossy codecs, bytes counted as the 4 uncompressed
+// columns, so MB_per_s compares directly, and the compression ratio
+template <class Codec>
+void bench_codec(bench::Harness& h, std::string const& name, Simulation const& sim,
+                 lotka_volterra::BlockTrajectory<Codec> const& empty)
+{
+  std::size_t const rows = sim.xs().size();
+  double const bytes     = static_cast<double>(rows * 4 * sizeof(double));
+  auto const encode      = [&sim](lotka_volterra::BlockTrajectory<Codec>& trajectory) {
+    trajectory.append(sim.ts(), sim.xs(), sim.ys(), sim.Hs());
+    trajectory.flush();
+  };
+
+  std::string const prefix = "compress/" + name + "/rows=" + std::to_string(rows);
+  if (!h.enabled(prefix)) {
+    return;
+  }
+  lotka_volterra::BlockTrajectory<Codec> coded = empty;
+  encode(coded);
+
+  h.run(prefix + "/encode", static_cast<double>(rows), bytes, [&empty] { return empty; }, encode);
+  h.annotate(prefix + "/encode", "ratio", bytes / static_cast<double>(coded.compressedBytes()));
+  h.run(prefix + "/decode", static_cast<double>(rows), bytes, [rows] { return std::vector<double>(rows); },
+        [&coded, rows](std::vector<double>& out) {
+          for (std::size_t c = 0; c < 4; ++c) {
+            coded.column(c).decode(0, rows, out);
+            bench::keep(out[rows - 1]);
+          }
+        });
+}
+
+void bench_compression(bench::Harness& h)
+{
+  using lotka_volterra::ErrorBound;
+  using lotka_volterra::QuantizedCodec;
+  constexpr std::size_t rows = 1000000;
+
+  Simulation sim = make_simulation(0.0001);
+  sim.evolveSteps(rows - 1);
+  check_completed(sim);
+
+  QuantizedCodec const time{ErrorBound::absolute(1e-12)};
+  bench_codec(h, "lossless", sim, lotka_volterra::CompressedTrajectory{});
+  for (double bound : {1e-3, 1e-6, 1e-9}) {
+    QuantizedCodec const codec{ErrorBound::absolute(bound)};
+    bench_codec(h, "lossy/abs=" + format(bound), sim, lotka_volterra::LossyTrajectory{0, {time, codec, codec, codec}});
+  }
+  QuantizedCodec const relative{ErrorBound::relative(1e-6)};
+  bench_codec(h, "lossy/rel=" + format(1e-6), sim, lotka_volterra::LossyTrajectory{0, {time, relative, relative, relative}});
+}
+
+// frame time of Renderer::draw against the trajectory length, one new state per frame as in main.cpp
+void bench_renderer(bench::Harness& h)
+{
+  constexpr std::size_t frames = 1000;
+  std::size_t const lengths[]  = {1000, 10000, 100000, 1000000, 10000000};
+
+  sf::RenderTexture target;
+  if (!target.create(800, 800)) {
+    throw std::runtime_error("cannot create render texture.");
+  }
+
+  Simulation sim = make_simulation(0.0001);
+  sim.evolveSteps(lengths[std::size(lengths) - 1] + frames);
+
+  for (std::size_t length : lengths) {
+    h.run("Renderer::draw/steps=" + std::to_string(length), frames, 0.,
+          [&target, &sim, length] {
+            auto ren = std::make_unique<lotka_volterra::Renderer>(800);
+            ren->draw(target, sim, length); // builds the trajectory up to length
+            return ren;
+          },
+          [&target, &sim, length](std::unique_ptr<lotka_volterra::Renderer>& ren) {
+            for (std::size_t frame = 1; frame <= frames; ++frame) {
+              target.clear(sf::Color::White);
+              ren->draw(target, sim, length + frame);
+              target.display();
+            }
+          });
+  }
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  try {
+    std::size_t repetitions = 5;
+    std::string filter;
+    std::string output;
+
+    for (int i = 1; i < argc; ++i) {
+      std::string const arg = argv[i];
+      if (i + 1 >= argc) {
+        throw std::invalid_argument("missing value for " + arg + ".");
+      }
+      std::string const value = argv[++i];
+      if (arg == "--repetitions") {
+        repetitions = std::stoul(value);
+      } else if (arg == "--filter") {
+        filter = value;
+      } else if (arg == "--output") {
+        output = value;
+      } else {
+        throw std::invalid_argument("unknown option " + arg + ".");
+      }
+    }
+    if (repetitions == 0) {
+      throw std::invalid_argument("repetitions must be > 0.");
+    }
+
+    bench::Harness h{repetitions, filter};
+    bench_simulation(h);
+    bench_energy(h);
+    bench_csv(h);
+    bench_compression(h);
+    bench_renderer(h);
+
+    if (output.empty()) {
+      h.writeJSON(std::cout, build_info());
+    } else {
+      std::ofstream file{output};
+      if (!file) {
+        throw std::runtime_error("cannot open file.");
+      }
+      h.writeJSON(file, build_info());
+    }
+
+    return 0;
+  } catch (std::exception const& e) {
+    std::cerr << "Fatal error: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,153 @@
+#ifndef HARNESS_HPP
+#define HARNESS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+// keeps a computed value alive without letting the compiler see through it
+template <class T>
+void keep(T const& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result
+{
+  std::string name;
+  double items; // work per repetition (steps, evaluations, frames), 0 if not meaningful
+  double bytes; // bytes written per repetition, 0 if not meaningful
+  std::vector<double> seconds;
+  std::vector<std::pair<std::string, double>> metrics; // reported as they are, e.g. a compression ratio
+};
+
+class Harness
+{
+private:
+  std::size_t repetitions_;
+  std::string filter_;
+  std::vector<Result> results_;
+
+  static double mean(std::vector<double> const& v)
+  {
+    return std::accumulate(v.begin(), v.end(), 0.) / static_cast<double>(v.size());
+  }
+
+  static double variance(std::vector<double> const& v) // sample variance, 0 with a single repetition
+  {
+    if (v.size() < 2) {
+      return 0.;
+    }
+    double const m = mean(v);
+    double sum     = 0.;
+    for (double x : v) {
+      sum += (x - m) * (x - m);
+    }
+    return sum / static_cast<double>(v.size() - 1);
+  }
+
+  static double median(std::vector<double> v)
+  {
+    std::sort(v.begin(), v.end());
+    std::size_t const n = v.size();
+    return (n % 2 == 1) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+  }
+
+  static std::string escape(std::string const& s)
+  {
+    std::string out;
+    for (char c : s) {
+      if (c == '"' || c == '\\') {
+        out += '\\';
+      }
+      out += c;
+    }
+    return out;
+  }
+
+public:
+  Harness(std::size_t repetitions, std::string filter)
+      : repetitions_{repetitions}
+      , filter_{std::move(filter)}
+  {}
+
+  bool enabled(std::string const& name) const
+  {
+    return filter_.empty() || name.find(filter_) != std::string::npos;
+  }
+
+  // setup() builds a fresh input for every repetition and is not timed; body(input) is timed.
+  // One untimed warm-up repetition runs first
+  template <class Setup, class Body>
+  void run(std::string const& name, double items, double bytes, Setup setup, Body body)
+  {
+    if (!enabled(name)) {
+      return;
+    }
+    std::cerr << name << "\n";
+
+    {
+      auto input = setup();
+      body(input);
+    }
+
+    Result result{name, items, bytes, {}, {}};
+    for (std::size_t r = 0; r < repetitions_; ++r) {
+      auto input       = setup();
+      auto const start = std::chrono::steady_clock::now();
+      body(input);
+      std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+      result.seconds.push_back(elapsed.count());
+    }
+    results_.push_back(std::move(result));
+  }
+
+  // adds a metric measured outside the timed body to the result of a benchmark, if it ran
+  void annotate(std::string const& name, std::string const& key, double value)
+  {
+    for (Result& r : results_) {
+      if (r.name == name) {
+        r.metrics.emplace_back(key, value);
+      }
+    }
+  }
+
+  void writeJSON(std::ostream& os, std::string const& build) const
+  {
+    os.precision(9);
+    os << "{\n  \"build\": " << build << ",\n  \"repetitions\": " << repetitions_ << ",\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results_.size(); ++i) {
+      Result const& r   = results_[i];
+      double const m    = mean(r.seconds);
+      double const var  = variance(r.seconds);
+      double const best = *std::min_element(r.seconds.begin(), r.seconds.end());
+
+      os << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << escape(r.name) << "\", \"seconds\": [";
+      for (std::size_t s = 0; s < r.seconds.size(); ++s) {
+        os << (s == 0 ? "" : ", ") << r.seconds[s];
+      }
+      os << "], \"mean_s\": " << m << ", \"variance_s2\": " << var << ", \"stddev_s\": " << std::sqrt(var)
+         << ", \"cv\": " << std::sqrt(var) / m << ", \"min_s\": " << best << ", \"median_s\": " << median(r.seconds);
+      if (r.items > 0.) {
+        os << ", \"items\": " << r.items << ", \"items_per_s\": " << r.items / m << ", \"ns_per_item\": " << 1e9 * m / r.items;
+      }
+      if (r.bytes > 0.) {
+        os << ", \"bytes\": " << r.bytes << ", \"MB_per_s\": " << r.bytes / m / 1e6;
+      }
+      for (auto const& [key, value] : r.metrics) {
+        os << ", \"" << escape(key) << "\": " << value;
+      }
+      os << "}";
+    }
+    os << "\n  ]\n}\n";
+  }
+};
+} // namespace bench
+
+#endif
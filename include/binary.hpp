@@ -0,0 +1,104 @@
+#ifndef BINARY_HPP
+#define BINARY_HPP
+
+#include "simulation.hpp"
+#include "stream.hpp"
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace io {
+// file layout: a BinaryHeader, then the t, x, y and H columns, `rows` little-endian doubles each.
+// With the compressed flag every column is instead: block count and byte count (uint64), the block index
+// (first value and byte offset, uint64 each), the coded bytes and zero padding to a multiple of 8 bytes.
+// With the lossy flag too, the counts of every column are preceded by its error bound (uint32 mode, 4 zero bytes,
+// double value)
+struct BinaryHeader
+{
+  char magic[8];              // "LVTRAJ\0\0"
+  std::uint32_t version;      // 1
+  std::uint32_t header_size;  // offset of the first column, in bytes
+  std::uint64_t rows;
+  std::uint64_t first_step;   // index of the first stored state, > 0 for a bounded history
+  double dt;
+  double pars[4];             // A, B, C, D
+  double H0;
+  double max_rel_drift;
+  std::uint32_t integrator;   // lotka_volterra::Integrator
+  std::uint32_t flags;        // binary_unstable, binary_compressed, binary_lossy
+  std::uint32_t column_count; // 4
+  std::uint8_t reserved[28];
+};
+static_assert(sizeof(BinaryHeader) == 128);
+
+inline constexpr std::uint32_t binary_version    = 1;
+inline constexpr std::uint32_t binary_unstable   = 1;
+inline constexpr std::uint32_t binary_compressed = 2;
+inline constexpr std::uint32_t binary_lossy      = 4;
+
+// every writer takes an optional gzip or zstd stream compression: the file is then read back after zcat or zstdcat
+void outputBinary(lotka_volterra::Simulation const& simulation, std::string const& filename, Compression const& compression = {});
+
+// lossless compressed file of the whole stored trajectory, the archive of a compressed history included
+void outputCompressed(lotka_volterra::Simulation const& simulation, std::string const& filename,
+                      Compression const& compression = {});
+
+struct CompressedRun
+{
+  BinaryHeader header;
+  lotka_volterra::CompressedTrajectory trajectory;
+};
+
+CompressedRun inputCompressed(std::string const& filename);
+
+// error-bounded lossy compressed file, with one bound per column (t, x, y, H): every decoded value is within its
+// bound of the stored one. The first overload codes the whole stored trajectory, the second one a trajectory coded
+// while the simulation evolved, with the simulation only providing the header
+void outputLossy(lotka_volterra::Simulation const& simulation, std::array<lotka_volterra::ErrorBound, 4> const& bounds,
+                 std::string const& filename, Compression const& compression = {});
+void outputLossy(lotka_volterra::Simulation const& simulation, lotka_volterra::LossyTrajectory const& trajectory,
+                 std::string const& filename, Compression const& compression = {});
+
+struct LossyRun
+{
+  BinaryHeader header;
+  lotka_volterra::LossyTrajectory trajectory;
+};
+
+LossyRun inputLossy(std::string const& filename);
+
+// read-only memory mapping of a binary trajectory: the columns are spans over the file pages, loaded on first access
+class MappedTrajectory
+{
+private:
+  std::byte const* data_ = nullptr;
+  std::size_t size_      = 0;
+  BinaryHeader header_{};
+
+  std::span<double const> column(std::size_t i) const;
+
+public:
+  explicit MappedTrajectory(std::string const& filename);
+  MappedTrajectory(MappedTrajectory const&)            = delete;
+  MappedTrajectory& operator=(MappedTrajectory const&) = delete;
+  MappedTrajectory(MappedTrajectory&& other) noexcept;
+  MappedTrajectory& operator=(MappedTrajectory&& other) noexcept;
+  ~MappedTrajectory();
+  std::uint32_t version() const;
+  lotka_volterra::Integrator method() const;
+  double dt() const;
+  double getParameter(std::size_t i) const;
+  double H0() const;
+  double maxRelDrift() const;
+  bool isUnstable() const;
+  std::size_t steps() const;
+  std::size_t firstStep() const;
+  std::span<double const> ts() const;
+  std::span<double const> xs() const;
+  std::span<double const> ys() const;
+  std::span<double const> Hs() const;
+  lotka_volterra::TrajectoryView view() const;
+};
+} // namespace io
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace lotka_volterra {
+// lossless coding: the k-th difference of the IEEE bit patterns (integer arithmetic, so decoding is bit-exact),
+// zigzag and varint coded, with the order k = 1..8 chosen per block as the shortest. Smooth trajectories need
+// 1 to 3 bytes per value instead of 8
+struct LosslessCodec
+{
+  static constexpr std::size_t max_order = 8;
+
+  void encode(std::span<double const> values, std::vector<std::uint8_t>& out) const;
+  void decode(std::uint8_t const* p, std::uint8_t const* end, std::size_t n, std::size_t count, double* out) const;
+};
+
+struct ErrorBound
+{
+  enum class Mode : std::uint32_t
+  {
+    absolute, // |x - x'| <= value
+    relative  // |x - x'| <= value |x|
+  };
+
+  Mode mode;
+  double value;
+
+  static ErrorBound absolute(double value);
+  static ErrorBound relative(double value);
+};
+
+// error-bounded lossy coding, as in SZ: every value is predicted from the reconstructed previous ones (order 1..3,
+// chosen per block), the prediction error is quantized in steps of twice the bound and the codes are bit-packed
+// with the width chosen per block. Values that cannot be coded within the bound (the first one, NaN, inf,
+// outliers) are stored exactly
+class QuantizedCodec
+{
+public:
+  static constexpr std::size_t max_order = 3;
+
+private:
+  ErrorBound bound_;
+
+public:
+  explicit QuantizedCodec(ErrorBound bound);
+  ErrorBound bound() const;
+  void encode(std::span<double const> values, std::vector<std::uint8_t>& out) const;
+  void decode(std::uint8_t const* p, std::uint8_t const* end, std::size_t n, std::size_t count, double* out) const;
+};
+
+// column of doubles coded in blocks by Codec, appended as a stream and decoded with random access through the block
+// index
+template <class Codec>
+class BlockColumn
+{
+public:
+  static constexpr std::size_t block_size = 1024;
+
+  struct Block
+  {
+    std::uint64_t first;  // index of the first value
+    std::uint64_t offset; // position of the block in the byte stream
+  };
+
+private:
+  Codec codec_;
+  std::vector<std::uint8_t> bytes_;
+  std::vector<Block> index_;
+  std::vector<double> open_; // values of the block being filled, not coded yet
+  std::size_t sealed_ = 0;   // number of coded values
+
+  std::size_t block_of(std::size_t i) const;
+  std::size_t block_end(std::size_t b) const;
+  void decode_block(std::size_t b, std::size_t count, double* out) const;
+
+public:
+  BlockColumn() = default;
+  explicit BlockColumn(Codec codec);
+  BlockColumn(std::vector<std::uint8_t> bytes, std::vector<Block> index, std::size_t size, Codec codec = Codec{});
+  Codec const& codec() const;
+  void push_back(double value);
+  void append(std::span<double const> values);
+  void flush();
+  std::size_t size() const;
+  bool empty() const;
+  double at(std::size_t i) const;
+  void decode(std::size_t first, std::size_t last, std::span<double> out) const;
+  std::size_t compressedBytes() const;
+  std::span<std::uint8_t const> bytes() const;
+  std::span<Block const> index() const;
+};
+
+using CompressedColumn = BlockColumn<LosslessCodec>;
+using LossyColumn      = BlockColumn<QuantizedCodec>;
+
+extern template class BlockColumn<LosslessCodec>;
+extern template class BlockColumn<QuantizedCodec>;
+} // namespace lotka_volterra
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef CSV_HPP
+#define CSV_HPP
+
+#include "output.hpp"
+#include "simulation.hpp"
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace io {
+// trajectory read back from a CSV file written by outputCSV (or any file whose header names some of the columns t, x,
+// y, H, in any order; the columns it does not name are empty, see hasColumn). The file is memory-mapped, split in
+// chunks on line boundaries and parsed with std::from_chars by `threads` threads (0 for one per hardware thread),
+// straight into the columns. Empty lines at the end are skipped. A CSV file does not hold the parameters of the run, so
+// they are given to view(), which needs all four columns; H0 is the energy of the first row
+class CSVTrajectory
+{
+private:
+  std::size_t rows_ = 0;
+  std::unique_ptr<double[]> ts_;
+  std::unique_ptr<double[]> xs_;
+  std::unique_ptr<double[]> ys_;
+  std::unique_ptr<double[]> Hs_;
+
+public:
+  explicit CSVTrajectory(std::string const& filename, std::size_t threads = 0);
+  std::size_t steps() const;
+  bool hasColumn(Column column) const;
+  std::span<double const> ts() const;
+  std::span<double const> xs() const;
+  std::span<double const> ys() const;
+  std::span<double const> Hs() const;
+  lotka_volterra::TrajectoryView view(std::array<double, 4> const& pars) const;
+};
+} // namespace io
+
+#endif
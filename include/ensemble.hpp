@@ -0,0 +1,65 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include "simulation.hpp"
+#include <cstdint>
+
+#ifndef LV_ENSEMBLE_LANES
+#define LV_ENSEMBLE_LANES 8
+#endif
+
+namespace lotka_volterra {
+struct SystemParameters
+{
+  double A;
+  double B;
+  double C;
+  double D;
+  double x0;
+  double y0;
+};
+
+class EnsembleSimulation
+{
+public:
+  static constexpr std::size_t lanes = LV_ENSEMBLE_LANES;
+
+private:
+  struct alignas(64) Block
+  {
+    std::array<double, lanes> x;
+    std::array<double, lanes> y;
+    std::array<double, lanes> H;
+    std::array<double, lanes> A;
+    std::array<double, lanes> B;
+    std::array<double, lanes> C;
+    std::array<double, lanes> D;
+    std::array<double, lanes> max_rel_drift;
+    std::array<std::uint64_t, lanes> steps;
+    std::array<std::uint64_t, lanes> active;
+    std::array<std::uint64_t, lanes> unstable;
+  };
+
+  double dt_;
+  std::size_t size_;
+  std::vector<Block> blocks_;
+
+  void check_index(std::size_t i) const;
+  void step_block(Block& block) const;
+  bool evolve_blocks(std::size_t first, std::size_t last, std::size_t steps);
+
+public:
+  EnsembleSimulation(double dt, std::vector<SystemParameters> const& systems);
+  double dt() const;
+  std::size_t size() const;
+  State stateAt(std::size_t i) const;
+  std::size_t steps(std::size_t i) const;
+  double maxRelDrift(std::size_t i) const;
+  bool isUnstable(std::size_t i) const;
+  std::size_t unstableCount() const;
+  bool evolveSteps(std::size_t steps, std::size_t threads = 1);
+  bool evolveTime(double T, std::size_t threads = 1);
+};
+} // namespace lotka_volterra
+
+#endif
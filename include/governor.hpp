@@ -0,0 +1,41 @@
+#ifndef GOVERNOR_HPP
+#define GOVERNOR_HPP
+
+#include "simulation.hpp"
+
+namespace lotka_volterra {
+// paces a simulation evolved in an interactive loop, with one call of frame() per frame: the simulation gets a budget
+// of wall time in every frame, the rest is left to events and drawing. The budget starts at a fraction of the frame
+// period and adapts to the measured frame time, shrinking when frames run late and growing back while they are on
+// time. With a speed factor the simulated time follows the wall time at that rate, 0 runs as fast as the budget allows
+class Governor
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  double period_;                // target frame period, s
+  double max_budget_;            // s
+  double budget_;                // s
+  double speed_            = 0.; // simulated time per second of wall time, 0 for as fast as possible
+  double target_time_      = 0.; // simulated time the simulation should have reached
+  double frame_seconds_    = 0.;
+  double steps_per_second_ = 0.;
+  Clock::time_point last_frame_;
+  bool started_ = false;
+  bool synced_  = false;
+
+  void adapt_budget();
+
+public:
+  explicit Governor(double frame_rate, double budget_fraction = 0.5);
+  double speed() const;
+  void setSpeed(double factor);
+  double budget() const;
+  double frameSeconds() const;
+  double stepsPerSecond() const;
+  std::size_t frame(Simulation& simulation, std::size_t max_steps = std::numeric_limits<std::size_t>::max());
+};
+} // namespace lotka_volterra
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef INTEGRATOR_HPP
+#define INTEGRATOR_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace lotka_volterra {
+enum class Integrator
+{
+  Euler,
+  Heun,
+  RK4,
+  DormandPrince,
+  Strang,
+  Yoshida
+};
+
+// step policies on the relative variables: x' = A (1 - y) x, y' = D (x - 1) y
+struct EulerStep
+{
+  static constexpr double dt_min        = 0.0001;
+  static constexpr double dt_max        = 0.01;
+  static constexpr char const* dt_range = "parameter dt must be between 0.0001 and 0.01.";
+  static constexpr std::size_t stages   = 1;
+  static constexpr bool log_coordinates = false;
+
+  static void step(double& x_rel, double& y_rel, double A, double D, double dt)
+  {
+    double const x = x_rel;
+    double const y = y_rel;
+
+    double const x_next = x + A * (1 - y) * x * dt;
+    double const y_next = y + D * (x - 1) * y * dt;
+
+    x_rel = std::max(0., x_next);
+    y_rel = std::max(0., y_next);
+  }
+};
+
+struct HeunStep
+{
+  static constexpr double dt_min        = 0.0001;
+  static constexpr double dt_max        = 0.05;
+  static constexpr char const* dt_range = "parameter dt must be between 0.0001 and 0.05 for Heun.";
+  static constexpr std::size_t stages   = 2;
+  static constexpr bool log_coordinates = false;
+
+  static void step(double& x_rel, double& y_rel, double A, double D, double dt)
+  {
+    double const x = x_rel;
+    double const y = y_rel;
+
+    double const kx1 = A * (1 - y) * x;
+    double const ky1 = D * (x - 1) * y;
+    double const xp  = x + kx1 * dt; // Euler predictor
+    double const yp  = y + ky1 * dt;
+    double const kx2 = A * (1 - yp) * xp;
+    double const ky2 = D * (xp - 1) * yp;
+
+    x_rel = std::max(0., x + 0.5 * dt * (kx1 + kx2));
+    y_rel = std::max(0., y + 0.5 * dt * (ky1 + ky2));
+  }
+};
+
+struct RK4Step
+{
+  static constexpr double dt_min        = 0.0001;
+  static constexpr double dt_max        = 0.1;
+  static constexpr char const* dt_range = "parameter dt must be between 0.0001 and 0.1 for RK4.";
+  static constexpr std::size_t stages   = 4;
+  static constexpr bool log_coordinates = false;
+
+  static void step(double& x_rel, double& y_rel, double A, double D, double dt)
+  {
+    double const x = x_rel;
+    double const y = y_rel;
+    double const h = 0.5 * dt;
+
+    double const kx1 = A * (1 - y) * x;
+    double const ky1 = D * (x - 1) * y;
+    double const x2  = x + h * kx1;
+    double const y2  = y + h * ky1;
+    double const kx2 = A * (1 - y2) * x2;
+    double const ky2 = D * (x2 - 1) * y2;
+    double const x3  = x + h * kx2;
+    double const y3  = y + h * ky2;
+    double const kx3 = A * (1 - y3) * x3;
+    double const ky3 = D * (x3 - 1) * y3;
+    double const x4  = x + dt * kx3;
+    double const y4  = y + dt * ky3;
+    double const kx4 = A * (1 - y4) * x4;
+    double const ky4 = D * (x4 - 1) * y4;
+
+    x_rel = std::max(0., x + dt / 6. * (kx1 + 2. * kx2 + 2. * kx3 + kx4));
+    y_rel = std::max(0., y + dt / 6. * (ky1 + 2. * ky2 + 2. * ky3 + ky4));
+  }
+};
+
+// splitting methods on the log variables u = ln x, v = ln y: u' = A (1 - e^v), v' = D (e^u - 1);
+// each subflow keeps one variable fixed and is solved exactly, so the composition stays positive
+// and, being symplectic, keeps H bounded; ev = e^v on entry, eu = e^u and ev = e^v on exit
+struct StrangSplit
+{
+  static constexpr double dt_min        = 0.0001;
+  static constexpr double dt_max        = 0.1;
+  static constexpr char const* dt_range = "parameter dt must be between 0.0001 and 0.1 for Strang.";
+  static constexpr std::size_t stages   = 1;
+  static constexpr bool log_coordinates = true;
+
+  static void step(double& u, double& v, double& eu, double& ev, double A, double D, double dt)
+  {
+    u += 0.5 * dt * A * (1 - ev);
+    eu = std::exp(u);
+    v += dt * D * (eu - 1);
+    ev = std::exp(v);
+    u += 0.5 * dt * A * (1 - ev);
+    eu = std::exp(u);
+  }
+};
+
+// Yoshida triple jump: Strang steps of w1 dt, w0 dt, w1 dt, with the adjacent half steps merged
+struct YoshidaSplit
+{
+  static constexpr double dt_min        = 0.0001;
+  static constexpr double dt_max        = 0.05; // the negative inner step makes it less stable than Strang
+  static constexpr char const* dt_range = "parameter dt must be between 0.0001 and 0.05 for Yoshida.";
+  static constexpr std::size_t stages   = 3;
+  static constexpr bool log_coordinates = true;
+  static constexpr double w1            = 1.3512071919596578;  // 1 / (2 - 2^(1/3))
+  static constexpr double w0            = -1.7024143839193153; // 1 - 2 w1
+
+  static void step(double& u, double& v, double& eu, double& ev, double A, double D, double dt)
+  {
+    u += 0.5 * w1 * dt * A * (1 - ev);
+    eu = std::exp(u);
+    v += w1 * dt * D * (eu - 1);
+    ev = std::exp(v);
+    u += 0.5 * (w1 + w0) * dt * A * (1 - ev);
+    eu = std::exp(u);
+    v += w0 * dt * D * (eu - 1);
+    ev = std::exp(v);
+    u += 0.5 * (w0 + w1) * dt * A * (1 - ev);
+    eu = std::exp(u);
+    v += w1 * dt * D * (eu - 1);
+    ev = std::exp(v);
+    u += 0.5 * w1 * dt * A * (1 - ev);
+    eu = std::exp(u);
+  }
+};
+
+// embedded 5(4) pair with error estimate and 4th order dense output (Hairer, Norsett, Wanner, DOPRI5);
+// dt is the output interval, the integration steps are chosen by the error control
+struct DormandPrinceStep
+{
+  static constexpr double dt_min        = 0.0001;
+  static constexpr double dt_max        = 1.;
+  static constexpr char const* dt_range = "parameter dt must be between 0.0001 and 1 for Dormand-Prince.";
+  static constexpr std::size_t stages   = 6; // the last stage is reused as the first one of the next step
+
+  struct Trial
+  {
+    double x;
+    double y;
+    double kx; // derivatives at the new point
+    double ky;
+    double err; // scaled error norm, the step is accepted if err <= 1
+    std::array<double, 5> cx; // dense output coefficients
+    std::array<double, 5> cy;
+  };
+
+  static void rhs(double x, double y, double A, double D, double& kx, double& ky)
+  {
+    kx = A * (1 - y) * x;
+    ky = D * (x - 1) * y;
+  }
+
+  static Trial step(double x, double y, double kx1, double ky1, double A, double D, double h, double rtol, double atol)
+  {
+    double kx2, ky2, kx3, ky3, kx4, ky4, kx5, ky5, kx6, ky6;
+    Trial t;
+
+    rhs(x + h * (kx1 / 5.), y + h * (ky1 / 5.), A, D, kx2, ky2);
+    rhs(x + h * (3. / 40. * kx1 + 9. / 40. * kx2), y + h * (3. / 40. * ky1 + 9. / 40. * ky2), A, D, kx3, ky3);
+    rhs(x + h * (44. / 45. * kx1 - 56. / 15. * kx2 + 32. / 9. * kx3),
+        y + h * (44. / 45. * ky1 - 56. / 15. * ky2 + 32. / 9. * ky3), A, D, kx4, ky4);
+    rhs(x + h * (19372. / 6561. * kx1 - 25360. / 2187. * kx2 + 64448. / 6561. * kx3 - 212. / 729. * kx4),
+        y + h * (19372. / 6561. * ky1 - 25360. / 2187. * ky2 + 64448. / 6561. * ky3 - 212. / 729. * ky4), A, D, kx5, ky5);
+    rhs(x + h * (9017. / 3168. * kx1 - 355. / 33. * kx2 + 46732. / 5247. * kx3 + 49. / 176. * kx4 - 5103. / 18656. * kx5),
+        y + h * (9017. / 3168. * ky1 - 355. / 33. * ky2 + 46732. / 5247. * ky3 + 49. / 176. * ky4 - 5103. / 18656. * ky5), A, D,
+        kx6, ky6);
+
+    t.x = x + h * (35. / 384. * kx1 + 500. / 1113. * kx3 + 125. / 192. * kx4 - 2187. / 6784. * kx5 + 11. / 84. * kx6);
+    t.y = y + h * (35. / 384. * ky1 + 500. / 1113. * ky3 + 125. / 192. * ky4 - 2187. / 6784. * ky5 + 11. / 84. * ky6);
+    rhs(t.x, t.y, A, D, t.kx, t.ky); // first same as last
+
+    double const ex = h * (71. / 57600. * kx1 - 71. / 16695. * kx3 + 71. / 1920. * kx4 - 17253. / 339200. * kx5 + 22. / 525. * kx6 - 1. / 40. * t.kx);
+    double const ey = h * (71. / 57600. * ky1 - 71. / 16695. * ky3 + 71. / 1920. * ky4 - 17253. / 339200. * ky5 + 22. / 525. * ky6 - 1. / 40. * t.ky);
+    double const sx = atol + rtol * std::max(std::abs(x), std::abs(t.x));
+    double const sy = atol + rtol * std::max(std::abs(y), std::abs(t.y));
+    t.err           = std::sqrt(0.5 * ((ex / sx) * (ex / sx) + (ey / sy) * (ey / sy)));
+
+    double const d1 = -12715105075. / 11282082432.;
+    double const d3 = 87487479700. / 32700410799.;
+    double const d4 = -10690763975. / 1880347072.;
+    double const d5 = 701980252875. / 199316789632.;
+    double const d6 = -1453857185. / 822651844.;
+    double const d7 = 69997945. / 29380423.;
+
+    t.cx[0] = x;
+    t.cx[1] = t.x - x;
+    t.cx[2] = h * kx1 - t.cx[1];
+    t.cx[3] = t.cx[1] - h * t.kx - t.cx[2];
+    t.cx[4] = h * (d1 * kx1 + d3 * kx3 + d4 * kx4 + d5 * kx5 + d6 * kx6 + d7 * t.kx);
+    t.cy[0] = y;
+    t.cy[1] = t.y - y;
+    t.cy[2] = h * ky1 - t.cy[1];
+    t.cy[3] = t.cy[1] - h * t.ky - t.cy[2];
+    t.cy[4] = h * (d1 * ky1 + d3 * ky3 + d4 * ky4 + d5 * ky5 + d6 * ky6 + d7 * t.ky);
+
+    return t;
+  }
+
+  // value at t_old + theta * h, 0 <= theta <= 1
+  static double interpolate(std::array<double, 5> const& c, double theta)
+  {
+    double const theta1 = 1. - theta;
+    return c[0] + theta * (c[1] + theta1 * (c[2] + theta * (c[3] + theta1 * c[4])));
+  }
+};
+} // namespace lotka_volterra
+
+#endif
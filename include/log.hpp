@@ -0,0 +1,130 @@
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include "simulation.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace io {
+enum class LogLevel
+{
+  debug,
+  info,
+  warning,
+  error
+};
+
+enum class LogFormat
+{
+  text, // [info] step 1000 | t = 1 | x = 1.2 | y = 0.8 | H = 2.1
+  json  // one object per line: {"time":0.5,"level":"info","step":1000,"t":1,"x":1.2,"y":0.8,"H":2.1}
+};
+
+// asynchronous run log: logging a state or a message only copies a fixed-size record into a lock-free bounded ring
+// (several threads can log at once, each record claimed by one atomic compare-and-swap), and a background thread
+// formats the records and writes them to the outputs every flush interval. Nothing on the logging side waits or
+// allocates: when the ring is full the record is dropped and counted, and the count is logged as a warning. Records
+// below the level are discarded on the spot; messages longer than max_message characters are cut
+class Logger
+{
+public:
+  static constexpr std::size_t max_message = 95;
+
+private:
+  enum class Kind : unsigned char
+  {
+    state,
+    message
+  };
+
+  struct Record
+  {
+    double time; // s since the logger started
+    std::size_t step;
+    double t;
+    lotka_volterra::State state;
+    LogLevel level;
+    Kind kind;
+    unsigned char length;
+    char text[max_message];
+  };
+
+  struct Slot
+  {
+    std::atomic<std::size_t> sequence;
+    Record record;
+  };
+
+  struct Output
+  {
+    std::ostream* stream;
+    LogFormat format;
+  };
+
+  std::size_t capacity_;
+  std::unique_ptr<Slot[]> ring_;
+  alignas(64) std::atomic<std::size_t> head_{0}; // next slot to claim, shared by the loggers
+  alignas(64) std::size_t tail_ = 0;             // next slot to write out, with mutex_ held
+  alignas(64) std::atomic<std::size_t> dropped_{0};
+  std::atomic<LogLevel> level_;
+  std::chrono::steady_clock::time_point start_;
+  std::vector<Output> outputs_;
+  std::vector<std::unique_ptr<std::ofstream>> files_;
+  std::string line_;
+  std::mutex mutex_; // outputs and the consumer side, never taken by the loggers
+  std::jthread flusher_;
+
+  bool push(Record const& record);
+  void write(Record const& record);
+  void write_out(); // with mutex_ held
+
+public:
+  explicit Logger(LogLevel level = LogLevel::info, std::size_t capacity = 4096,
+                  std::chrono::milliseconds interval = std::chrono::milliseconds{100});
+  Logger(Logger const&)            = delete;
+  Logger& operator=(Logger const&) = delete;
+  ~Logger();
+  void addOutput(std::ostream& stream, LogFormat format = LogFormat::text);
+  void addFile(std::string const& filename, LogFormat format = LogFormat::json);
+  LogLevel level() const;
+  void setLevel(LogLevel level);
+  bool enabled(LogLevel level) const;
+  void log(LogLevel level, std::string_view message);
+  void logState(LogLevel level, std::size_t step, double t, lotka_volterra::State const& state);
+  std::size_t dropped() const;
+  void flush();
+};
+
+struct Sampling
+{
+  std::size_t every_steps = 0; // log the states whose step is a multiple, 0 for none
+  double every_seconds    = 0.; // log the last state of a chunk once this much wall time has passed, 0 for never
+};
+
+// sink that logs the states of a simulation picked by a Sampling; it looks at the clock once per chunk of states, and
+// at the steps to log only, so that it costs next to nothing per step
+class LogSink : public lotka_volterra::StateSink
+{
+private:
+  Logger& logger_;
+  Sampling sampling_;
+  LogLevel level_;
+  std::chrono::steady_clock::time_point next_time_;
+
+public:
+  LogSink(Logger& logger, Sampling const& sampling, LogLevel level = LogLevel::info);
+  void consume(std::size_t step, double t, lotka_volterra::State const& state) override;
+  void consumeRange(std::size_t first, std::span<double const> t, std::span<double const> x, std::span<double const> y,
+                    std::span<double const> H) override;
+};
+} // namespace io
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef NUMPY_HPP
+#define NUMPY_HPP
+
+#include "ensemble.hpp"
+#include "simulation.hpp"
+#include "stream.hpp"
+#include <string>
+
+namespace io {
+// .npy (format version 1.0): one 2-D float64 array in Fortran order, so that every column is contiguous in the file.
+// A trajectory is a (rows, 4) array of t, x, y, H; an ensemble a (systems, 3) array of the current x, y, H.
+// A compressed file (.npy.gz, .npy.zst) is read with np.load(gzip.open(filename)) or after zcat/zstdcat
+void outputNPY(lotka_volterra::TrajectoryView const& trajectory, std::string const& filename, Compression const& compression = {});
+void outputNPY(lotka_volterra::EnsembleSimulation const& ensemble, std::string const& filename, Compression const& compression = {});
+
+// .npz: an uncompressed zip of one .npy per column, loaded by name (np.load(filename)["x"]). It is never stream
+// compressed, which would hide the zip from np.load.
+// A trajectory has t, x, y, H and parameters (A, B, C, D); an ensemble x, y, H, max_rel_drift, steps and unstable
+void outputNPZ(lotka_volterra::TrajectoryView const& trajectory, std::string const& filename);
+void outputNPZ(lotka_volterra::EnsembleSimulation const& ensemble, std::string const& filename);
+} // namespace io
+
+#endif
@@ -2,11 +2,62 @@
 #define OUTPUT_HPP
 
 #include "simulation.hpp"
+#include "stream.hpp"
+#include "trace.hpp"
 #include <string>
+#include <vector>
 
 namespace io {
+enum class Column
+{
+  t,
+  x,
+  y,
+  H
+};
+
+struct CSVOptions
+{
+  std::vector<Column> columns{Column::t, Column::x, Column::y, Column::H};
+  int precision          = 6; // significant digits, 0 for the shortest representation that reads back exactly
+  std::size_t threads    = 1; // formatting threads, the file is written by the calling thread
+  std::size_t chunk_rows = 65536;
+  Compression compression; // gzip or zstd stream, compressed by a worker thread
+};
+
+class CSVSink : public lotka_volterra::StateSink
+{
+private:
+  OutputStream stream_;
+  CSVOptions options_;
+  std::string buffer_;
+
+public:
+  explicit CSVSink(std::string const& filename, CSVOptions options = {});
+  ~CSVSink() override;
+  void consume(std::size_t step, double t, lotka_volterra::State const& state) override;
+  void flush();
+};
+
+// write-behind CSV export: consume() only copies the state into the output stream, in blocks of options.chunk_rows
+// rows that the worker of the stream formats (and compresses) and writes while the simulation goes on. At most
+// OutputStream::max_blocks are in flight, beyond that consume() waits for the worker. flush() returns once every state
+// consumed so far is in the file, and an error of the worker is thrown by a later consume() or flush(). The file is the
+// same as with CSVSink
+class AsyncCSVSink : public lotka_volterra::StateSink
+{
+private:
+  OutputStream stream_; // formats the rows with a copy of the options
+
+public:
+  explicit AsyncCSVSink(std::string const& filename, CSVOptions const& options = {});
+  void consume(std::size_t step, double t, lotka_volterra::State const& state) override;
+  void flush();
+};
+
 void outputStatus(lotka_volterra::Simulation const& simulation);
-void outputCSV(lotka_volterra::Simulation const& simulation, std::string const& filename);
+void outputCSV(lotka_volterra::TrajectoryView const& trajectory, std::string const& filename, CSVOptions const& options = {});
+void outputTrace(std::string const& filename, Compression const& compression = {});
 } // namespace io
 
-#endif
\ No newline at end of file
+#endif
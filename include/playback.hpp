@@ -0,0 +1,67 @@
+#ifndef PLAYBACK_HPP
+#define PLAYBACK_HPP
+
+#include "renderer.hpp"
+#include <vector>
+
+namespace lotka_volterra {
+// playback of a stored trajectory (a finished Simulation, a MappedTrajectory or a CSVTrajectory, which must outlive
+// it) at a chosen speed, independent of the integration: the position advances by a number of states per frame or by
+// an amount of simulated time per second, backwards with a negative speed, and can be paused and moved anywhere.
+// A keyframe every keyframe_interval states holds the time of its state and the extents of the states before it:
+// seekTime() is a binary search over the keyframes and then within one interval, O(log n), and draw() restores the
+// extents of the renderer from the keyframe before the new position instead of rescanning the trajectory
+class Playback
+{
+public:
+  static constexpr std::size_t keyframe_interval = 4096;
+
+  enum class Mode
+  {
+    steps, // states per frame
+    time   // simulated time per second
+  };
+
+private:
+  struct Keyframe
+  {
+    double t;     // time of state k * keyframe_interval
+    double max_x; // extents of the states before it
+    double max_y;
+  };
+
+  TrajectoryView trajectory_;
+  std::vector<Keyframe> keyframes_;
+  Mode mode_         = Mode::steps;
+  double speed_      = 1.;
+  double position_   = 0.; // index of the last shown state, fractional in steps mode
+  double clock_      = 0.; // simulated time of the playback, between the times of two states in time mode
+  std::size_t drawn_ = 0;  // states drawn by the last draw()
+  bool paused_       = false;
+
+  void check_speed(double speed) const;
+  std::size_t index_at(double t) const;
+
+public:
+  explicit Playback(TrajectoryView const& trajectory);
+  Mode mode() const;
+  double speed() const;
+  void setStepsPerFrame(double steps);
+  void setTimeRate(double rate);
+  void pause();
+  void resume();
+  void togglePause();
+  bool isPaused() const;
+  bool atEnd() const;
+  bool atStart() const;
+  std::size_t step() const; // states shown, from 1 to trajectory.steps()
+  double time() const;      // time of the last shown state
+  void advance(double seconds);
+  void seekStep(std::size_t step);
+  void seekTime(double t);
+  void rewind();
+  void draw(Renderer& renderer, sf::RenderTarget& window);
+};
+} // namespace lotka_volterra
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef QUEUE_HPP
+#define QUEUE_HPP
+
+#include "simulation.hpp"
+#include <atomic>
+#include <memory>
+
+namespace lotka_volterra {
+// lock-free single-producer single-consumer queue of states, from a simulation thread to a render thread. As a sink
+// it fills chunks of chunk_states states in a ring of preallocated chunks, and a chunk is published when it is full
+// or on publish(); the only synchronization is one atomic index per side (release on publish, acquire on read), so
+// neither side ever takes a lock or allocates. When the ring is full the producer yields until the consumer frees a
+// chunk, so no state is ever dropped; after close() it drops them instead, so it can never wait for a consumer that is
+// gone. drain() hands every state published so far to a sink (a RendererFeed) on the consumer thread
+class StateQueue : public StateSink
+{
+public:
+  static constexpr std::size_t chunk_states = 1024;
+
+private:
+  struct Chunk
+  {
+    std::size_t first_step;
+    std::size_t count;
+    std::array<double, chunk_states> ts;
+    std::array<State, chunk_states> states;
+  };
+
+  std::size_t capacity_; // chunks
+  std::unique_ptr<Chunk[]> ring_;
+  alignas(64) std::atomic<std::size_t> head_{0}; // chunks published, written by the producer
+  alignas(64) std::atomic<std::size_t> tail_{0}; // chunks drained, written by the consumer
+  alignas(64) std::atomic<bool> finished_{false};
+  std::atomic<bool> closed_{false};
+  alignas(64) std::size_t filling_ = 0; // states in the chunk being filled, producer only
+  std::size_t received_            = 0; // consumer only
+  double time_                     = 0.;
+
+  bool wait_for_room(std::size_t head);
+
+public:
+  explicit StateQueue(std::size_t chunks = 64);
+  StateQueue(StateQueue const&)            = delete;
+  StateQueue& operator=(StateQueue const&) = delete;
+  // producer side
+  void consume(std::size_t step, double t, State const& state) override;
+  void publish();
+  void finish();
+  // consumer side
+  std::size_t drain(StateSink& sink);
+  std::size_t received() const;
+  double time() const;
+  bool exhausted() const;
+  void close();
+};
+} // namespace lotka_volterra
+
+#endif
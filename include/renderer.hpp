@@ -3,10 +3,29 @@
 
 #include "simulation.hpp"
 #include <SFML/Graphics.hpp>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <string>
 
 namespace lotka_volterra {
+// figures of the run shown by the HUD that the renderer cannot see itself
+struct HudStats
+{
+  double steps_per_second = 0.;
+  std::size_t states      = 0;  // stored
+  std::size_t state_bytes = 0;  // memory of the stored states
+  double drift_tolerance  = 0.; // relative change of H in a step that stops the run (50 dt), 0 if none
+};
+
 class Renderer
 {
+public:
+  static constexpr std::size_t hud_frames = 256; // frames the percentiles of the HUD are taken over
+
+private:
+  using Clock = std::chrono::steady_clock;
+
 private:
   std::size_t size_;
   double world_max_;
@@ -19,37 +38,78 @@ private:
   double max_y_;
   float axis_offset_;
   float axis_length_;
+  double margin_;
+  sf::Vector2f ui_size_;
+  sf::Vector2u window_size_;
+  sf::View world_view_;
   sf::VertexArray trajectory_{sf::LineStrip};
+  std::vector<std::string> tick_labels_;
   sf::Text label_;
   sf::Font font_;
+  sf::Text hud_text_;
+  sf::RectangleShape hud_panel_;
+  HudStats hud_stats_;
+  std::array<float, hud_frames> frame_times_{}; // s, of the last frames, in a ring
+  std::size_t frame_count_ = 0;
+  Clock::time_point last_frame_;
+  Clock::time_point last_hud_update_;
+  double last_H_     = std::numeric_limits<double>::quiet_NaN(); // H of the last two states drawn, for the drift
+  double previous_H_ = std::numeric_limits<double>::quiet_NaN();
   std::size_t last_drawn_step_  = 0;
+  std::size_t extent_step_      = 0;
   int tick_count_               = 10;
   unsigned int label_font_size_ = 12;
   float eq_point_radius_        = 5.f;
+  double hud_interval_          = 0.25; // s between two updates of the HUD text
   bool set_                     = false;
+  bool layout_dirty_            = true;
+  bool hud_                     = false;
 
   void check_parameter(std::size_t size) const;
   void check_set() const;
-  void validate_window(sf::RenderWindow const& window) const;
+  void check_step(TrajectoryView const& trajectory, std::size_t current_step) const;
+  void check_resident(TrajectoryView const& trajectory, std::size_t step) const;
+  void validate_window(sf::RenderTarget const& window) const;
   sf::Color color_energy(double H, double H0) const;
   double compute_tick_step(double max_value) const;
   double step_tick(double margin, double max_x, double max_y) const;
   double max_world(double margin, double max_x, double max_y) const;
   double scale(double world_max, float axis_offset, sf::View const& ui_view) const;
-  void update_trajectory(Simulation const& simulation, std::size_t current_step);
+  void update_extents(TrajectoryView const& trajectory, std::size_t current_step);
+  void update_layout(sf::RenderTarget const& window, sf::View const& ui_view, double margin, float axis_offset);
+  void update_trajectory(TrajectoryView const& trajectory, std::size_t current_step);
+  void update_hud();
 
 public:
   Renderer(std::size_t size);
   std::size_t size() const;
-  void setDraw(sf::RenderWindow& window, Simulation const& simulation, std::size_t current_step, sf::View const& ui_view,
+  void append(std::size_t step, State const& state, double H0);
+  void restoreExtents(std::size_t step, double max_x, double max_y);
+  void setDraw(sf::RenderTarget& window, TrajectoryView const& trajectory, std::size_t current_step, sf::View const& ui_view,
                sf::View& world_view, double margin = 1.2, float axis_offset = 100.f);
-  void drawAxes(sf::RenderWindow& window, sf::View const& ui_view) const;
-  void drawTicks(sf::RenderWindow& window, sf::View const& ui_view);
-  void drawTrajectory(sf::RenderWindow& window, Simulation const& simulation, std::size_t current_step, sf::View const& world_view);
-  void drawEqPoints(sf::RenderWindow& window, sf::View const& ui_view, sf::View const& world_view) const;
-  void drawTitles(sf::RenderWindow& window, sf::View const& ui_view) const;
-  void draw(sf::RenderWindow& window, Simulation const& simulation, std::size_t current_step);
-  void draw(sf::RenderWindow& window, Simulation const& simulation);
+  void drawAxes(sf::RenderTarget& window, sf::View const& ui_view) const;
+  void drawTicks(sf::RenderTarget& window, sf::View const& ui_view);
+  void drawTrajectory(sf::RenderTarget& window, TrajectoryView const& trajectory, std::size_t current_step, sf::View const& world_view);
+  void drawEqPoints(sf::RenderTarget& window, sf::View const& ui_view, sf::View const& world_view) const;
+  void drawTitles(sf::RenderTarget& window, sf::View const& ui_view) const;
+  bool hud() const;
+  void setHud(bool enabled);
+  void setHudStats(HudStats const& stats);
+  std::string hudText() const;
+  void drawHud(sf::RenderTarget& window, sf::View const& ui_view);
+  void draw(sf::RenderTarget& window, TrajectoryView const& trajectory, std::size_t current_step);
+  void draw(sf::RenderTarget& window, TrajectoryView const& trajectory);
+};
+
+class RendererFeed : public StateSink
+{
+private:
+  Renderer& renderer_;
+  double H0_;
+
+public:
+  RendererFeed(Renderer& renderer, Simulation const& simulation);
+  void consume(std::size_t step, double t, State const& state) override;
 };
 } // namespace lotka_volterra
 
@@ -1,7 +1,13 @@
 #ifndef SIMULATION_HPP
 #define SIMULATION_HPP
 
+#include "compression.hpp"
+#include "integrator.hpp"
+#include "store.hpp"
 #include <array>
+#include <chrono>
+#include <limits>
+#include <span>
 #include <vector>
 
 namespace lotka_volterra {
@@ -12,34 +18,159 @@ struct State
   double H;
 };
 
+class StateSink
+{
+public:
+  virtual ~StateSink()                                                = default;
+  virtual void consume(std::size_t step, double t, State const& state) = 0;
+  // the states of a chunk, from step first on: one consume() each by default, a sink that looks at a few of them only
+  // (a sampling logger) skips the others without a call per state
+  virtual void consumeRange(std::size_t first, std::span<double const> t, std::span<double const> x,
+                            std::span<double const> y, std::span<double const> H);
+};
+
+// trajectory stored as t, x, y, H columns coded by Codec, with random access to every state. As a sink it codes the
+// states of a simulation while it evolves, starting from the first state it is given
+template <class Codec>
+class BlockTrajectory : public StateSink
+{
+private:
+  std::size_t first_step_ = 0;
+  std::array<BlockColumn<Codec>, 4> columns_;
+
+public:
+  explicit BlockTrajectory(std::size_t first_step = 0, std::array<Codec, 4> const& codecs = {});
+  BlockTrajectory(std::size_t first_step, std::array<BlockColumn<Codec>, 4> columns);
+  void consume(std::size_t step, double t, State const& state) override;
+  void append(std::span<double const> ts, std::span<double const> xs, std::span<double const> ys, std::span<double const> Hs);
+  void flush();
+  std::size_t firstStep() const;
+  std::size_t steps() const;
+  State stateAt(std::size_t i) const;
+  double timeAt(std::size_t i) const;
+  BlockColumn<Codec> const& column(std::size_t i) const;
+  std::size_t compressedBytes() const;
+};
+
+using CompressedTrajectory = BlockTrajectory<LosslessCodec>;
+using LossyTrajectory      = BlockTrajectory<QuantizedCodec>;
+
+extern template class BlockTrajectory<LosslessCodec>;
+extern template class BlockTrajectory<QuantizedCodec>;
+
 class Simulation
 {
 private:
   double dt_;
   double x_rel_;
   double y_rel_;
+  double u_; // ln x_rel_ and ln y_rel_, the state of the splitting integrators
+  double v_;
+  double H_offset_; // H - D (e^u - u) - A (e^v - v), constant
   std::array<double, 4> pars_;
-  std::vector<State> states_;
-  double max_rel_drift_;
-  bool unstable_ = false;
+  Integrator method_;
+  StateStore states_; // t, x, y, H columns
+  std::vector<StateSink*> sinks_;
+  CompressedTrajectory archive_; // states evicted from a compressed history
+  std::vector<double> scratch_;  // buffers of evolve_steps, kept across calls
+  double H0_;
+  double max_rel_drift_        = 0.;
+  double rtol_                 = 1e-6;
+  double atol_                 = 1e-9;
+  double h_                    = 0.; // next adaptive step size, 0 until the first adaptive step
+  std::size_t rhs_evaluations_ = 0;
+  std::size_t first_step_      = 0;
+  std::size_t history_         = 0;
+  std::size_t chunk_size_      = 1024;
+  bool unstable_               = false;
+  bool compressed_             = false;
 
   void check_parameters(double dt, double A, double B, double C, double D, double x0, double y0) const;
-  void integrate();
   double compute_H(double x, double y);
+  template <class Method>
+  void check_dt(double dt) const;
+  template <class Method>
+  bool evolve_one();
+  template <class Method>
+  bool evolve_steps(std::size_t add_steps);
+  bool evolve_grid(std::span<double const> times);
+  void push_states(std::span<double const> t, std::span<double const> x, std::span<double const> y,
+                   std::span<double const> H);
+  void push_state(double t, double x, double y, double H);
+  void evict();
+  std::span<double> scratch(std::size_t size);
 
 public:
-  Simulation(double dt, double A, double B, double C, double D, double x0 = 0., double y0 = 0.);
+  Simulation(double dt, double A, double B, double C, double D, double x0 = 0., double y0 = 0.,
+             Integrator method = Integrator::Euler);
+  Simulation(Simulation const& other);
+  Simulation(Simulation&& other)            = default;
+  Simulation& operator=(Simulation const& other);
+  Simulation& operator=(Simulation&& other) = default;
+  Integrator method() const;
+  double energy(double x, double y) const;
+  std::size_t chunkSize() const;
+  void setChunkSize(std::size_t chunk_size);
+  double rtol() const;
+  double atol() const;
+  void setTolerances(double rtol, double atol);
+  std::size_t rhsEvaluations() const;
   double dt() const;
+  double time() const;
   double H() const;
+  double H0() const;
   double maxRelDrift() const;
   double const& getParameter(std::size_t i) const;
   std::size_t steps() const;
-  State const& stateAt(std::size_t i) const;
+  std::size_t firstStep() const;
+  std::size_t history() const;
+  std::size_t stateBytes() const;
+  void reserve(std::size_t states);
+  void setHistory(std::size_t capacity);
+  void setCompressedHistory(std::size_t resident);
+  bool isCompressed() const;
+  CompressedTrajectory const& archive() const;
+  void addSink(StateSink& sink);
+  void removeSink(StateSink& sink);
+  State stateAt(std::size_t i) const;
+  double timeAt(std::size_t i) const;
+  std::span<double const> ts() const;
+  std::span<double const> xs() const;
+  std::span<double const> ys() const;
+  std::span<double const> Hs() const;
   bool evolve();
   bool evolveSteps(std::size_t steps);
   bool evolveTime(double T);
+  std::size_t evolveFor(std::chrono::steady_clock::time_point deadline, std::size_t max_steps = std::numeric_limits<std::size_t>::max());
+  bool evolveGrid(std::span<double const> times);
   bool isUnstable() const;
 };
+
+// read-only view of a stored trajectory, from a Simulation or from a file, with the same accessors
+class TrajectoryView
+{
+private:
+  std::span<double const> ts_;
+  std::span<double const> xs_;
+  std::span<double const> ys_;
+  std::span<double const> Hs_;
+  std::array<double, 4> pars_;
+  double H0_;
+  std::size_t first_step_;
+
+public:
+  TrajectoryView(std::span<double const> ts, std::span<double const> xs, std::span<double const> ys,
+                 std::span<double const> Hs, std::array<double, 4> const& pars, double H0, std::size_t first_step = 0);
+  TrajectoryView(Simulation const& simulation); // implicit, as std::string_view from std::string
+  double getParameter(std::size_t i) const;
+  double H0() const;
+  std::size_t steps() const;
+  std::size_t firstStep() const;
+  std::span<double const> ts() const;
+  std::span<double const> xs() const;
+  std::span<double const> ys() const;
+  std::span<double const> Hs() const;
+};
 } // namespace lotka_volterra
 
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include "simulation.hpp"
+
+namespace lotka_volterra {
+struct Summary
+{
+  double min;
+  double max;
+  double mean;
+};
+
+class RunningStatistics : public StateSink
+{
+private:
+  std::size_t count_   = 0;
+  std::size_t H_count_ = 0;
+  Summary x_;
+  Summary y_;
+  Summary H_;
+
+  void check_count() const;
+  void add(Summary& summary, double value, std::size_t count) const;
+
+public:
+  RunningStatistics();
+  void consume(std::size_t step, double t, State const& state) override;
+  std::size_t count() const;
+  Summary x() const;
+  Summary y() const;
+  Summary H() const;
+};
+} // namespace lotka_volterra
+
+#endif
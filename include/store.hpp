@@ -0,0 +1,59 @@
+#ifndef STORE_HPP
+#define STORE_HPP
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace lotka_volterra {
+// append-only t, x, y, H columns of a simulation, in a range of address space reserved for range_states states (or
+// what reserve() asks for) on the first append, whose pages the kernel commits as they are first written: an append
+// never copies the states before it. When the range is full the store falls back to a new range of twice the states,
+// into which the states are copied once; the old range stays mapped and is never written again, so a span or a
+// reference taken before keeps reading the same states for the life of the store. The range and the length are
+// published with release stores once the new states are written, so other threads can read the first size() states of
+// every column while one thread appends, across the growth of the store. Only eraseFront() (bounded histories) moves
+// states, and needs the readers to stop
+class StateStore
+{
+public:
+  static constexpr std::size_t range_states = std::size_t{1} << 20; // 8 MiB of address space per column
+
+private:
+  struct Range
+  {
+    std::array<double*, 4> columns; // the four columns one after the other, in a single mapping
+    std::size_t capacity;           // states per column
+  };
+
+  std::vector<std::unique_ptr<Range>> ranges_; // every range so far, the last one in use; owned by the writer
+  std::atomic<Range const*> range_{nullptr};   // the range in use, for the readers
+  std::atomic<std::size_t> size_{0};
+
+  std::span<double const> column(std::size_t i) const;
+  void grow(std::size_t states);
+  void release();
+
+public:
+  StateStore() = default; // reserves nothing until the first append
+  StateStore(StateStore const& other);
+  StateStore(StateStore&& other) noexcept;
+  StateStore& operator=(StateStore other) noexcept;
+  ~StateStore();
+  std::size_t size() const;
+  std::size_t capacity() const;
+  std::size_t bytes() const;
+  void reserve(std::size_t states);
+  std::span<double const> ts() const;
+  std::span<double const> xs() const;
+  std::span<double const> ys() const;
+  std::span<double const> Hs() const;
+  void append(std::span<double const> t, std::span<double const> x, std::span<double const> y, std::span<double const> H);
+  void push_back(double t, double x, double y, double H);
+  void eraseFront(std::size_t n);
+};
+} // namespace lotka_volterra
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace io {
+struct Compression
+{
+  enum class Format
+  {
+    none,
+    gzip, // readable by zcat, gzip -d
+    zstd  // readable by zstdcat, zstd -d; only if zstd was found at configure time
+  };
+
+  Format format = Format::none;
+  int level     = 0; // 0 for the default of the format, else 1..9 for gzip and 1..19 for zstd
+};
+
+bool isAvailable(Compression::Format format);
+
+// sequential binary output to a file, compressed as it is written if asked. With compression or a formatter the bytes
+// are collected in blocks of block_size (or block_bytes), formatted, compressed and written by a worker thread, so that
+// the caller only copies them; at most max_blocks are in flight, beyond that write() waits for the worker, and an
+// error of the worker is thrown by a later write() or flush(). flush() makes everything written so far readable from
+// the file, finish() ends the compressed stream and closes the file. The destructor finishes the stream too, but
+// cannot report errors: call finish() to know that the file is complete
+class OutputStream
+{
+public:
+  static constexpr std::size_t block_size = std::size_t{1} << 20;
+  static constexpr std::size_t max_blocks = 4;
+
+  enum class Mode
+  {
+    more,  // more data follows
+    flush, // make everything so far decodable
+    end    // end of the stream
+  };
+
+  class Encoder; // gzip or zstd state, in stream.cpp
+
+  // turns a block as written into the bytes of the file, appending to out; called by the worker, in order, for every
+  // block handed over (the last one may be empty)
+  using Formatter = std::function<void(std::vector<char> const& block, std::vector<char>& out)>;
+
+private:
+  struct Block
+  {
+    std::vector<char> bytes;
+    Mode mode;
+  };
+
+  std::ofstream file_;
+  std::unique_ptr<Encoder> encoder_; // null without compression
+  Formatter formatter_;              // empty to write the bytes as they are
+  std::size_t block_bytes_ = block_size;
+  std::vector<char> block_;             // being filled by write()
+  std::deque<Block> queue_;             // handed to the worker, in order
+  std::vector<std::vector<char>> free_; // written blocks, whose storage is reused
+  std::size_t pending_ = 0;             // blocks queued or being written
+  bool stop_           = false;
+  bool finished_       = false;
+  std::exception_ptr error_; // first error of the worker, thrown by write() and flush()
+  std::mutex mutex_;
+  std::condition_variable ready_;   // signals the worker
+  std::condition_variable drained_; // signals write(), flush() and finish()
+  std::thread worker_;              // only with compression or a formatter
+
+  void run();
+  void hand_over(Mode mode); // with the lock held
+  void drain(Mode mode);
+
+public:
+  explicit OutputStream(std::string const& filename, Compression const& compression = {});
+  // every write() must be whole records of the formatter, and block_bytes a multiple of their size
+  OutputStream(std::string const& filename, Compression const& compression, Formatter formatter, std::size_t block_bytes);
+  OutputStream(OutputStream const&)            = delete;
+  OutputStream& operator=(OutputStream const&) = delete;
+  ~OutputStream();
+  void write(void const* data, std::size_t size);
+  void flush();
+  void finish();
+};
+} // namespace io
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace lotka_volterra {
+struct TraceEvent
+{
+  char const* name;      // string literal, never copied
+  std::int64_t start;    // ns since Trace::start()
+  std::int64_t duration; // ns, for a scope
+  double value;          // for a counter
+  std::uint32_t thread;  // order in which the threads first recorded
+  char phase;            // 'X' scope (complete event), 'C' counter, as in the Chrome trace_event format
+};
+
+// low-overhead recorder of the time spent in the hot paths: every thread records its events into a buffer of its own,
+// allocated once with room for max_events, so recording takes no lock, never allocates and never waits for another
+// thread; the events past max_events are dropped and counted. Nothing is recorded outside start()/stop(), and a trace
+// point then costs a single relaxed load. events() collects the events of every thread, to be written by
+// io::outputTrace once the traced threads are done (joined, or idle after stop())
+class Trace
+{
+public:
+  static constexpr std::size_t max_events = std::size_t{1} << 20; // per thread, 40 MiB of address space
+
+  using Clock = std::chrono::steady_clock;
+
+private:
+  static inline std::atomic<bool> enabled_{false};
+
+public:
+  static void start(); // drops the events of the previous trace
+  static void stop();
+  static bool enabled() // inline: the only cost of a trace point while tracing is off
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+  static std::int64_t now(); // ns since start()
+  static void record(TraceEvent const& event);
+  static void counter(char const* name, double value);
+  static std::vector<TraceEvent> events();
+  static std::size_t dropped();
+};
+
+// records the time from its construction to its destruction as a complete event, if tracing was on at construction
+class TraceScope
+{
+private:
+  char const* name_;
+  std::int64_t start_;
+
+public:
+  explicit TraceScope(char const* name)
+      : name_{name}
+      , start_{Trace::enabled() ? Trace::now() : -1}
+  {}
+  TraceScope(TraceScope const&)            = delete;
+  TraceScope& operator=(TraceScope const&) = delete;
+  ~TraceScope()
+  {
+    if (start_ >= 0) {
+      Trace::record({name_, start_, Trace::now() - start_, 0., 0, 'X'});
+    }
+  }
+};
+} // namespace lotka_volterra
+
+// trace points, compiled out entirely unless LV_TRACE is defined (CMake option LV_TRACE, on by default)
+#ifdef LV_TRACE
+#define LV_TRACE_JOIN_(a, b) a##b
+#define LV_TRACE_JOIN(a, b) LV_TRACE_JOIN_(a, b)
+#define LV_TRACE_SCOPE(name) lotka_volterra::TraceScope const LV_TRACE_JOIN(trace_scope_, __LINE__){name}
+#define LV_TRACE_COUNTER(name, value) lotka_volterra::Trace::counter(name, static_cast<double>(value))
+#else
+#define LV_TRACE_SCOPE(name) static_cast<void>(0)
+#define LV_TRACE_COUNTER(name, value) static_cast<void>(0)
+#endif
+
+#endif
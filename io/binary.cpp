@@ -0,0 +1,417 @@
+#include "binary.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::endian::native == std::endian::little, "the binary format stores little-endian doubles.");
+
+namespace io {
+namespace {
+constexpr char magic[8] = {'L', 'V', 'T', 'R', 'A', 'J', '\0', '\0'};
+
+void check_header(BinaryHeader const& header)
+{
+  if (std::memcmp(header.magic, magic, sizeof magic) != 0) {
+    throw std::runtime_error("not a binary trajectory file.");
+  }
+  if (header.version != binary_version) {
+    throw std::runtime_error("unsupported binary trajectory version.");
+  }
+  if (header.header_size < sizeof(BinaryHeader) || header.header_size % sizeof(double) != 0 || header.column_count != 4
+      || header.integrator > static_cast<std::uint32_t>(lotka_volterra::Integrator::Yoshida)) {
+    throw std::runtime_error("corrupted binary trajectory header.");
+  }
+}
+
+void check_size(BinaryHeader const& header, std::size_t size)
+{
+  if ((header.flags & binary_compressed) != 0) {
+    throw std::runtime_error("compressed binary trajectory, read it with io::inputCompressed.");
+  }
+  if (header.header_size > size || header.rows > (size - header.header_size) / (4 * sizeof(double))
+      || size != header.header_size + header.rows * 4 * sizeof(double)) {
+    throw std::runtime_error("binary trajectory file size does not match its header.");
+  }
+}
+
+BinaryHeader make_header(lotka_volterra::Simulation const& simulation, std::size_t rows, std::size_t first_step)
+{
+  BinaryHeader header{};
+  std::memcpy(header.magic, magic, sizeof magic);
+  header.version       = binary_version;
+  header.header_size   = sizeof(BinaryHeader);
+  header.rows          = rows;
+  header.first_step    = first_step;
+  header.dt            = simulation.dt();
+  header.H0            = simulation.H0();
+  header.max_rel_drift = simulation.maxRelDrift();
+  header.integrator    = static_cast<std::uint32_t>(simulation.method());
+  header.flags         = simulation.isUnstable() ? binary_unstable : 0u;
+  header.column_count  = 4;
+  for (std::size_t i = 0; i < 4; ++i) {
+    header.pars[i] = simulation.getParameter(i);
+  }
+  return header;
+}
+
+void read(std::ifstream& file, void* data, std::size_t size)
+{
+  file.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+  if (!file) {
+    throw std::runtime_error("binary trajectory file is truncated.");
+  }
+}
+
+static_assert(sizeof(lotka_volterra::CompressedColumn::Block) == 16);
+static_assert(sizeof(lotka_volterra::LossyColumn::Block) == 16);
+
+// error bound of a lossy column, stored before its counts
+struct StoredBound
+{
+  std::uint32_t mode;
+  std::uint32_t reserved;
+  double value;
+};
+
+void write_codec(OutputStream&, lotka_volterra::LosslessCodec const&)
+{}
+
+void write_codec(OutputStream& file, lotka_volterra::QuantizedCodec const& codec)
+{
+  StoredBound const bound{static_cast<std::uint32_t>(codec.bound().mode), 0, codec.bound().value};
+  file.write(&bound, sizeof bound);
+}
+
+lotka_volterra::LosslessCodec read_codec(std::ifstream&, lotka_volterra::LosslessCodec const*)
+{
+  return {};
+}
+
+lotka_volterra::QuantizedCodec read_codec(std::ifstream& file, lotka_volterra::QuantizedCodec const*)
+{
+  StoredBound bound;
+  read(file, &bound, sizeof bound);
+  try {
+    return lotka_volterra::QuantizedCodec{{static_cast<lotka_volterra::ErrorBound::Mode>(bound.mode), bound.value}};
+  } catch (std::invalid_argument const&) {
+    throw std::runtime_error("corrupted compressed column.");
+  }
+}
+
+template <class Codec>
+void write_trajectory(OutputStream& file, lotka_volterra::Simulation const& simulation,
+                      lotka_volterra::BlockTrajectory<Codec> const& trajectory, std::uint32_t flags)
+{
+  BinaryHeader header = make_header(simulation, trajectory.steps() - trajectory.firstStep(), trajectory.firstStep());
+  header.flags |= flags;
+  file.write(&header, sizeof header);
+
+  constexpr char padding[8] = {};
+  for (std::size_t c = 0; c < 4; ++c) {
+    lotka_volterra::BlockColumn<Codec> const& column = trajectory.column(c);
+    std::uint64_t const counts[2]                     = {column.index().size(), column.bytes().size()};
+    write_codec(file, column.codec());
+    file.write(counts, sizeof counts);
+    file.write(column.index().data(), column.index().size_bytes());
+    file.write(column.bytes().data(), column.bytes().size());
+    file.write(padding, (8 - column.bytes().size() % 8) % 8);
+  }
+}
+
+template <class Codec>
+lotka_volterra::BlockColumn<Codec> read_column(std::ifstream& file, std::size_t file_size, std::size_t rows)
+{
+  Codec codec = read_codec(file, static_cast<Codec const*>(nullptr));
+  std::uint64_t counts[2]; // blocks, bytes
+  read(file, counts, sizeof counts);
+  std::size_t const remaining = file_size - static_cast<std::size_t>(file.tellg());
+  if (counts[0] > remaining / 16 || counts[1] > remaining - counts[0] * 16) {
+    throw std::runtime_error("binary trajectory file is truncated.");
+  }
+
+  std::vector<typename lotka_volterra::BlockColumn<Codec>::Block> index(static_cast<std::size_t>(counts[0]));
+  std::vector<std::uint8_t> bytes(static_cast<std::size_t>(counts[1]));
+  read(file, index.data(), index.size() * 16);
+  read(file, bytes.data(), bytes.size());
+  file.ignore(static_cast<std::streamsize>((8 - bytes.size() % 8) % 8));
+
+  try {
+    return {std::move(bytes), std::move(index), rows, std::move(codec)};
+  } catch (std::invalid_argument const&) {
+    throw std::runtime_error("corrupted compressed column.");
+  }
+}
+
+// opens a compressed file and checks its header against the lossy flag expected
+BinaryHeader read_header(std::ifstream& file, bool lossy)
+{
+  if (!file) {
+    throw std::runtime_error("cannot open file.");
+  }
+
+  BinaryHeader header{};
+  file.read(reinterpret_cast<char*>(&header), sizeof header);
+  if (!file) {
+    throw std::runtime_error("not a binary trajectory file.");
+  }
+  check_header(header);
+  if ((header.flags & binary_compressed) == 0) {
+    throw std::runtime_error("uncompressed binary trajectory, open it with io::MappedTrajectory.");
+  }
+  if (!lossy && (header.flags & binary_lossy) != 0) {
+    throw std::runtime_error("lossy compressed binary trajectory, read it with io::inputLossy.");
+  }
+  if (lossy && (header.flags & binary_lossy) == 0) {
+    throw std::runtime_error("lossless compressed binary trajectory, read it with io::inputCompressed.");
+  }
+  file.ignore(static_cast<std::streamsize>(header.header_size - sizeof header));
+  return header;
+}
+
+template <class Codec>
+lotka_volterra::BlockTrajectory<Codec> read_trajectory(std::ifstream& file, std::string const& filename,
+                                                       BinaryHeader const& header)
+{
+  std::size_t const file_size = std::filesystem::file_size(filename);
+  std::size_t const rows      = static_cast<std::size_t>(header.rows);
+  std::array<lotka_volterra::BlockColumn<Codec>, 4> columns{read_column<Codec>(file, file_size, rows),
+                                                            read_column<Codec>(file, file_size, rows),
+                                                            read_column<Codec>(file, file_size, rows),
+                                                            read_column<Codec>(file, file_size, rows)};
+  return lotka_volterra::BlockTrajectory<Codec>{static_cast<std::size_t>(header.first_step), std::move(columns)};
+}
+} // namespace
+
+void outputBinary(lotka_volterra::Simulation const& simulation, std::string const& filename, Compression const& compression)
+{
+  OutputStream file{filename, compression};
+
+  BinaryHeader const header = make_header(simulation, simulation.xs().size(), simulation.firstStep());
+  file.write(&header, sizeof header);
+
+  for (std::span<double const> column : {simulation.ts(), simulation.xs(), simulation.ys(), simulation.Hs()}) {
+    file.write(column.data(), column.size_bytes());
+  }
+  file.finish();
+}
+
+void outputCompressed(lotka_volterra::Simulation const& simulation, std::string const& filename, Compression const& compression)
+{
+  lotka_volterra::CompressedTrajectory trajectory =
+      simulation.isCompressed() ? simulation.archive() : lotka_volterra::CompressedTrajectory{simulation.firstStep()};
+  trajectory.append(simulation.ts(), simulation.xs(), simulation.ys(), simulation.Hs());
+  trajectory.flush();
+
+  OutputStream file{filename, compression};
+  write_trajectory(file, simulation, trajectory, binary_compressed);
+  file.finish();
+}
+
+CompressedRun inputCompressed(std::string const& filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  BinaryHeader const header = read_header(file, false);
+  return {header, read_trajectory<lotka_volterra::LosslessCodec>(file, filename, header)};
+}
+
+void outputLossy(lotka_volterra::Simulation const& simulation, std::array<lotka_volterra::ErrorBound, 4> const& bounds,
+                 std::string const& filename, Compression const& compression)
+{
+  std::array<lotka_volterra::QuantizedCodec, 4> const codecs{lotka_volterra::QuantizedCodec{bounds[0]},
+                                                             lotka_volterra::QuantizedCodec{bounds[1]},
+                                                             lotka_volterra::QuantizedCodec{bounds[2]},
+                                                             lotka_volterra::QuantizedCodec{bounds[3]}};
+  std::size_t const first = simulation.isCompressed() ? simulation.archive().firstStep() : simulation.firstStep();
+  lotka_volterra::LossyTrajectory trajectory{first, codecs};
+
+  if (simulation.isCompressed()) { // decoded a chunk at a time, the archive can be far larger than memory
+    constexpr std::size_t chunk = 1 << 16;
+    std::array<std::vector<double>, 4> buffers;
+    for (std::vector<double>& buffer : buffers) {
+      buffer.resize(chunk);
+    }
+    std::size_t const size = simulation.archive().steps() - first;
+    for (std::size_t i = 0; i < size; i += chunk) {
+      std::size_t const n = std::min(chunk, size - i);
+      for (std::size_t c = 0; c < 4; ++c) {
+        simulation.archive().column(c).decode(i, i + n, buffers[c]);
+      }
+      trajectory.append(std::span{buffers[0]}.first(n), std::span{buffers[1]}.first(n), std::span{buffers[2]}.first(n),
+                        std::span{buffers[3]}.first(n));
+    }
+  }
+  trajectory.append(simulation.ts(), simulation.xs(), simulation.ys(), simulation.Hs());
+  outputLossy(simulation, trajectory, filename, compression);
+}
+
+void outputLossy(lotka_volterra::Simulation const& simulation, lotka_volterra::LossyTrajectory const& trajectory,
+                 std::string const& filename, Compression const& compression)
+{
+  lotka_volterra::LossyTrajectory sealed = trajectory;
+  sealed.flush();
+
+  OutputStream file{filename, compression};
+  write_trajectory(file, simulation, sealed, binary_compressed | binary_lossy);
+  file.finish();
+}
+
+LossyRun inputLossy(std::string const& filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  BinaryHeader const header = read_header(file, true);
+  return {header, read_trajectory<lotka_volterra::QuantizedCodec>(file, filename, header)};
+}
+
+MappedTrajectory::MappedTrajectory(std::string const& filename)
+{
+  int const fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open file.");
+  }
+
+  struct stat st{};
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(BinaryHeader))) {
+    ::close(fd);
+    throw std::runtime_error("not a binary trajectory file.");
+  }
+  std::size_t const size = static_cast<std::size_t>(st.st_size);
+
+  void* const map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping keeps the file open
+  if (map == MAP_FAILED) {
+    throw std::runtime_error("cannot map file.");
+  }
+  data_ = static_cast<std::byte const*>(map);
+  size_ = size;
+
+  std::memcpy(&header_, data_, sizeof header_);
+  try {
+    check_header(header_);
+    check_size(header_, size_);
+  } catch (...) {
+    ::munmap(const_cast<std::byte*>(data_), size_);
+    throw;
+  }
+  ::madvise(const_cast<std::byte*>(data_), size_, MADV_SEQUENTIAL);
+}
+
+MappedTrajectory::MappedTrajectory(MappedTrajectory&& other) noexcept
+    : data_{std::exchange(other.data_, nullptr)}
+    , size_{std::exchange(other.size_, 0)}
+    , header_{other.header_}
+{}
+
+MappedTrajectory& MappedTrajectory::operator=(MappedTrajectory&& other) noexcept
+{
+  if (this != &other) {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+    data_   = std::exchange(other.data_, nullptr);
+    size_   = std::exchange(other.size_, 0);
+    header_ = other.header_;
+  }
+  return *this;
+}
+
+MappedTrajectory::~MappedTrajectory()
+{
+  if (data_ != nullptr) {
+    ::munmap(const_cast<std::byte*>(data_), size_);
+  }
+}
+
+std::span<double const> MappedTrajectory::column(std::size_t i) const
+{
+  if (data_ == nullptr) {
+    throw std::logic_error("the trajectory was moved from.");
+  }
+  std::size_t const rows = static_cast<std::size_t>(header_.rows);
+  // the mapping is page aligned and the header size a multiple of 8, so the columns are aligned doubles
+  return {reinterpret_cast<double const*>(data_ + header_.header_size) + i * rows, rows};
+}
+
+std::uint32_t MappedTrajectory::version() const
+{
+  return header_.version;
+}
+
+lotka_volterra::Integrator MappedTrajectory::method() const
+{
+  return static_cast<lotka_volterra::Integrator>(header_.integrator);
+}
+
+double MappedTrajectory::dt() const
+{
+  return header_.dt;
+}
+
+double MappedTrajectory::getParameter(std::size_t i) const
+{
+  if (i > 3) {
+    throw std::out_of_range("parameter index out of range.");
+  }
+  return header_.pars[i];
+}
+
+double MappedTrajectory::H0() const
+{
+  return header_.H0;
+}
+
+double MappedTrajectory::maxRelDrift() const
+{
+  return header_.max_rel_drift;
+}
+
+bool MappedTrajectory::isUnstable() const
+{
+  return (header_.flags & binary_unstable) != 0;
+}
+
+std::size_t MappedTrajectory::steps() const
+{
+  return firstStep() + static_cast<std::size_t>(header_.rows);
+}
+
+std::size_t MappedTrajectory::firstStep() const
+{
+  return static_cast<std::size_t>(header_.first_step);
+}
+
+std::span<double const> MappedTrajectory::ts() const
+{
+  return column(0);
+}
+
+std::span<double const> MappedTrajectory::xs() const
+{
+  return column(1);
+}
+
+std::span<double const> MappedTrajectory::ys() const
+{
+  return column(2);
+}
+
+std::span<double const> MappedTrajectory::Hs() const
+{
+  return column(3);
+}
+
+lotka_volterra::TrajectoryView MappedTrajectory::view() const
+{
+  return {ts(), xs(), ys(), Hs(), {header_.pars[0], header_.pars[1], header_.pars[2], header_.pars[3]}, H0(), firstStep()};
+}
+} // namespace io
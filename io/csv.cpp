@@ -0,0 +1,302 @@
+#include "csv.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace io {
+namespace {
+constexpr std::size_t min_chunk_bytes = std::size_t{1} << 20; // smaller files are not worth a thread per chunk
+
+// read-only mapping of a whole file, unmapped when parsing is over
+class Mapping
+{
+private:
+  char const* data_ = nullptr;
+  std::size_t size_ = 0;
+
+public:
+  explicit Mapping(std::string const& filename)
+  {
+    int const fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("cannot open file.");
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+      ::close(fd);
+      throw std::runtime_error("empty csv file.");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+
+    void* const map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file open
+    if (map == MAP_FAILED) {
+      throw std::runtime_error("cannot map file.");
+    }
+    data_ = static_cast<char const*>(map);
+    ::madvise(map, size_, MADV_WILLNEED); // the chunks are read in parallel, not from the start
+  }
+
+  Mapping(Mapping const&)            = delete;
+  Mapping& operator=(Mapping const&) = delete;
+
+  ~Mapping()
+  {
+    ::munmap(const_cast<char*>(data_), size_);
+  }
+
+  std::string_view text() const
+  {
+    return {data_, size_};
+  }
+};
+
+// runs task(0) on the calling thread and task(1) ... task(n - 1) on their own threads, then rethrows the error of
+// the first failed chunk, so that the reported line is the first bad one
+template <class Task>
+void run_chunks(std::size_t n, Task task)
+{
+  std::vector<std::exception_ptr> errors(n);
+  auto const guarded = [&errors, &task](std::size_t i) {
+    try {
+      task(i);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  };
+  {
+    std::vector<std::jthread> workers;
+    for (std::size_t i = 1; i < n; ++i) {
+      workers.emplace_back(guarded, i);
+    }
+    guarded(0);
+  } // workers join here
+  for (std::exception_ptr const& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+// column index (t, x, y, H) of every field of the header line, one to four distinct columns
+std::vector<std::size_t> parse_header(std::string_view line)
+{
+  constexpr std::array<std::string_view, 4> names{"t", "x", "y", "H"};
+
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  std::vector<std::size_t> fields;
+  std::array<bool, 4> seen{};
+  for (;;) {
+    std::size_t const comma     = line.find(',');
+    std::string_view const name = line.substr(0, comma);
+    auto const found            = std::find(names.begin(), names.end(), name);
+    if (found == names.end()) {
+      throw std::runtime_error("csv header names an unknown column \"" + std::string{name} + "\": the columns are t, x, y, H.");
+    }
+    std::size_t const column = static_cast<std::size_t>(found - names.begin());
+    if (seen[column]) {
+      throw std::runtime_error("csv header names the column " + std::string{name} + " twice.");
+    }
+    seen[column] = true;
+    fields.push_back(column);
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    line.remove_prefix(comma + 1);
+  }
+  return fields;
+}
+
+constexpr std::array<double, 23> powers_of_ten{1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// std::from_chars, with a fast path for the plain decimals written by outputCSV ([-]digits[.digits][e[+-]digits]):
+// when the decimal mantissa fits in 53 bits and the power of ten is at most 1e22, both are exact doubles and a single
+// multiplication or division gives the correctly rounded value (Clinger's fast path), the same as std::from_chars.
+// Everything else (17 significant digits, large exponents, inf, nan) goes to std::from_chars
+std::from_chars_result parse_double(char const* first, char const* last, double& value)
+{
+  char const* p       = first;
+  bool const negative = (p != last && *p == '-');
+  p += negative ? 1 : 0;
+
+  std::uint64_t mantissa = 0;
+  std::ptrdiff_t digits  = 0;
+  int exponent           = 0;
+  char const* const integer = p;
+  while (p != last && static_cast<unsigned>(*p - '0') < 10) {
+    mantissa = 10 * mantissa + static_cast<unsigned>(*p - '0');
+    ++p;
+  }
+  digits = p - integer;
+  if (p != last && *p == '.') {
+    char const* const fraction = ++p;
+    while (p != last && static_cast<unsigned>(*p - '0') < 10) {
+      mantissa = 10 * mantissa + static_cast<unsigned>(*p - '0');
+      ++p;
+    }
+    exponent = -static_cast<int>(p - fraction);
+    digits += p - fraction;
+  }
+  if (p != last && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool const negative_exponent = (p != last && *p == '-');
+    p += (p != last && (*p == '-' || *p == '+')) ? 1 : 0;
+    char const* const exponent_digits = p;
+    int e                             = 0;
+    while (p != last && static_cast<unsigned>(*p - '0') < 10 && p - exponent_digits < 4) {
+      e = 10 * e + (*p - '0');
+      ++p;
+    }
+    exponent += negative_exponent ? -e : e;
+    digits = (p == exponent_digits) ? 0 : digits; // "1e" is left to std::from_chars
+  }
+  if (digits == 0 || digits > 19 || mantissa > (std::uint64_t{1} << 53) || exponent < -22 || exponent > 22
+      || (p != last && static_cast<unsigned>(*p - '0') < 10)) {
+    return std::from_chars(first, last, value);
+  }
+  double const m = static_cast<double>(mantissa);
+  value = (exponent < 0) ? m / powers_of_ten[static_cast<std::size_t>(-exponent)] : m * powers_of_ten[static_cast<std::size_t>(exponent)];
+  value = negative ? -value : value;
+  return {p, std::errc{}};
+}
+
+// lines in [begin, end), the last one possibly without its newline. memchr is vectorized, std::count is not at -O2
+std::size_t count_rows(char const* begin, char const* end)
+{
+  std::size_t newlines = 0;
+  for (char const* p = begin; (p = static_cast<char const*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))) != nullptr; ++p) {
+    ++newlines;
+  }
+  return newlines + ((begin != end && end[-1] != '\n') ? 1 : 0);
+}
+
+// parses the rows of [p, end) into out[field][row], one pointer per field of the header; first_line is the line number
+// of the first row, for the errors
+void parse_rows(char const* p, char const* end, std::span<double* const> out, std::size_t first_line)
+{
+  std::size_t const last = out.size() - 1;
+  for (std::size_t row = 0; p != end; ++row) {
+    for (std::size_t f = 0; f <= last; ++f) {
+      auto const [next, ec] = parse_double(p, end, out[f][row]);
+      p                     = next;
+      if (f == last && p != end && *p == '\r') {
+        ++p;
+      }
+      bool const separated = (f == last) ? (p == end || *p == '\n') : (p != end && *p == ',');
+      if (ec != std::errc{} || !separated) {
+        throw std::runtime_error("invalid csv row at line " + std::to_string(first_line + row) + ".");
+      }
+      p += (p != end) ? 1 : 0;
+    }
+  }
+}
+} // namespace
+
+CSVTrajectory::CSVTrajectory(std::string const& filename, std::size_t threads)
+{
+  Mapping const mapping{filename};
+  std::string_view const text = mapping.text();
+  if (text.starts_with("\x1f\x8b") || text.starts_with("\x28\xb5\x2f\xfd")) {
+    throw std::runtime_error("compressed csv file: decompress it with zcat or zstdcat first.");
+  }
+
+  std::size_t const header_end          = text.find('\n');
+  std::vector<std::size_t> const fields = parse_header(text.substr(0, header_end));
+  char const* const body = (header_end == std::string_view::npos) ? text.data() + text.size() : text.data() + header_end + 1;
+  char const* end        = text.data() + text.size();
+  while (end != body && (end[-1] == '\n' || end[-1] == '\r')) { // empty lines at the end, and the last line end
+    --end;
+  }
+
+  // chunks of about the same size, each starting at the beginning of a line
+  std::size_t const available = (threads == 0) ? std::max<std::size_t>(std::thread::hardware_concurrency(), 1) : threads;
+  std::size_t const n         = std::min(available, static_cast<std::size_t>(end - body) / min_chunk_bytes + 1);
+  std::vector<char const*> bounds(n + 1, end);
+  bounds[0] = body;
+  for (std::size_t i = 1; i < n; ++i) {
+    char const* const guess = std::max(body + static_cast<std::size_t>(end - body) * i / n, bounds[i - 1]);
+    void const* const line  = std::memchr(guess, '\n', static_cast<std::size_t>(end - guess));
+    bounds[i]               = (line == nullptr) ? end : static_cast<char const*>(line) + 1;
+  }
+
+  // first pass counts the rows of every chunk, so that the second one parses straight into the columns
+  std::vector<std::size_t> first_row(n + 1, 0);
+  run_chunks(n, [&](std::size_t i) { first_row[i + 1] = count_rows(bounds[i], bounds[i + 1]); });
+  std::partial_sum(first_row.begin(), first_row.end(), first_row.begin());
+  std::size_t const rows = first_row[n];
+  if (rows == 0) {
+    throw std::runtime_error("csv file has no rows.");
+  }
+
+  // not zeroed: every value is written by the parser, and the pages are first touched by the thread of their chunk
+  rows_ = rows;
+  std::array<std::unique_ptr<double[]>*, 4> const columns{&ts_, &xs_, &ys_, &Hs_};
+  for (std::size_t column : fields) { // the others stay empty
+    columns[column]->reset(new double[rows]);
+  }
+  run_chunks(n, [&](std::size_t i) {
+    std::array<double*, 4> out{};
+    for (std::size_t f = 0; f < fields.size(); ++f) {
+      out[f] = columns[fields[f]]->get() + first_row[i];
+    }
+    parse_rows(bounds[i], bounds[i + 1], std::span{out}.first(fields.size()), first_row[i] + 2);
+  });
+}
+
+std::size_t CSVTrajectory::steps() const
+{
+  return rows_;
+}
+
+// the header named the column
+bool CSVTrajectory::hasColumn(Column column) const
+{
+  std::array<std::unique_ptr<double[]> const*, 4> const columns{&ts_, &xs_, &ys_, &Hs_};
+  return *columns[static_cast<std::size_t>(column)] != nullptr;
+}
+
+// empty if the header did not name the column
+std::span<double const> CSVTrajectory::ts() const
+{
+  return {ts_.get(), ts_ ? rows_ : 0};
+}
+
+std::span<double const> CSVTrajectory::xs() const
+{
+  return {xs_.get(), xs_ ? rows_ : 0};
+}
+
+std::span<double const> CSVTrajectory::ys() const
+{
+  return {ys_.get(), ys_ ? rows_ : 0};
+}
+
+std::span<double const> CSVTrajectory::Hs() const
+{
+  return {Hs_.get(), Hs_ ? rows_ : 0};
+}
+
+lotka_volterra::TrajectoryView CSVTrajectory::view(std::array<double, 4> const& pars) const
+{
+  if (!ts_ || !xs_ || !ys_ || !Hs_) {
+    throw std::runtime_error("csv file lacks some of the columns t, x, y, H: a trajectory view needs all four.");
+  }
+  return {ts(), xs(), ys(), Hs(), pars, Hs_[0]};
+}
+} // namespace io
@@ -0,0 +1,297 @@
+#include "log.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+namespace io {
+namespace {
+constexpr std::array<char const*, 4> level_names{"debug", "info", "warning", "error"};
+
+void append_number(std::string& line, double value, bool json)
+{
+  if (json && !std::isfinite(value)) { // not a JSON number
+    line += "null";
+    return;
+  }
+  char buffer[32];
+  char* const end = json ? std::to_chars(buffer, buffer + sizeof buffer, value).ptr // shortest exact form
+                         : std::to_chars(buffer, buffer + sizeof buffer, value, std::chars_format::general, 6).ptr;
+  line.append(buffer, end);
+}
+
+void append_json_string(std::string& line, std::string_view text)
+{
+  line += '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      line += '\\';
+      line += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escape[8];
+      std::snprintf(escape, sizeof escape, "\\u%04x", static_cast<unsigned int>(c));
+      line += escape;
+    } else {
+      line += c;
+    }
+  }
+  line += '"';
+}
+} // namespace
+
+// claims the next slot with a compare-and-swap on head_; the slot's sequence number tells whether it is free (equal to
+// the position) and, once the record is copied, publishes it to the consumer (position + 1)
+bool Logger::push(Record const& record)
+{
+  std::size_t position = head_.load(std::memory_order_relaxed);
+  for (;;) {
+    Slot& slot            = ring_[position % capacity_];
+    std::size_t const seq = slot.sequence.load(std::memory_order_acquire);
+    auto const difference = static_cast<std::ptrdiff_t>(seq - position);
+    if (difference == 0) {
+      if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        slot.record = record;
+        slot.sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (difference < 0) { // full: the consumer has not freed this slot yet
+      return false;
+    } else {
+      position = head_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void Logger::write(Record const& record)
+{
+  std::string_view const level = level_names[static_cast<std::size_t>(record.level)];
+  for (Output const& output : outputs_) {
+    line_.clear();
+    if (output.format == LogFormat::json) {
+      line_ += "{\"time\":";
+      append_number(line_, record.time, true);
+      line_ += ",\"level\":\"";
+      line_ += level;
+      line_ += '"';
+      if (record.kind == Kind::state) {
+        line_ += ",\"step\":";
+        line_ += std::to_string(record.step);
+        for (auto const& [name, value] : {std::pair{",\"t\":", record.t}, std::pair{",\"x\":", record.state.x},
+                                          std::pair{",\"y\":", record.state.y}, std::pair{",\"H\":", record.state.H}}) {
+          line_ += name;
+          append_number(line_, value, true);
+        }
+      } else {
+        line_ += ",\"message\":";
+        append_json_string(line_, {record.text, record.length});
+      }
+      line_ += "}\n";
+    } else {
+      line_ += '[';
+      line_ += level;
+      line_ += "] ";
+      if (record.kind == Kind::state) {
+        line_ += "step ";
+        line_ += std::to_string(record.step);
+        for (auto const& [name, value] : {std::pair{" | t = ", record.t}, std::pair{" | x = ", record.state.x},
+                                          std::pair{" | y = ", record.state.y}, std::pair{" | H = ", record.state.H}}) {
+          line_ += name;
+          append_number(line_, value, false);
+        }
+      } else {
+        line_.append(record.text, record.length);
+      }
+      line_ += '\n';
+    }
+    output.stream->write(line_.data(), static_cast<std::streamsize>(line_.size()));
+  }
+}
+
+// writes out every record published so far, in order; a record claimed but not yet copied stops it until next time
+void Logger::write_out()
+{
+  std::size_t const dropped = dropped_.exchange(0, std::memory_order_relaxed);
+  if (dropped != 0) {
+    Record report{};
+    report.time   = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    report.level  = LogLevel::warning;
+    report.kind   = Kind::message;
+    auto const n  = std::snprintf(report.text, max_message, "%zu log records dropped: the ring was full", dropped);
+    report.length = static_cast<unsigned char>(std::clamp(n, 0, static_cast<int>(max_message) - 1));
+    write(report);
+  }
+
+  for (std::size_t k = 0; k < capacity_; ++k) { // one ring at most: loggers faster than the output cannot hold it
+    Slot& slot = ring_[tail_ % capacity_];
+    if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+      break;
+    }
+    write(slot.record);
+    slot.sequence.store(tail_ + capacity_, std::memory_order_release); // free for the next round
+    ++tail_;
+  }
+  for (Output const& output : outputs_) {
+    output.stream->flush();
+  }
+}
+
+Logger::Logger(LogLevel level, std::size_t capacity, std::chrono::milliseconds interval)
+    : capacity_{capacity}
+    , level_{level}
+    , start_{std::chrono::steady_clock::now()}
+{
+  if (capacity == 0) {
+    throw std::invalid_argument("parameter capacity must be > 0.");
+  }
+  if (interval <= std::chrono::milliseconds::zero()) {
+    throw std::invalid_argument("parameter interval must be > 0.");
+  }
+  ring_ = std::make_unique<Slot[]>(capacity);
+  for (std::size_t i = 0; i < capacity; ++i) {
+    ring_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  flusher_ = std::jthread{[this, interval](std::stop_token stop) {
+    std::mutex wake;
+    std::condition_variable_any timer;
+    while (!stop.stop_requested()) {
+      {
+        std::unique_lock lock{wake};
+        timer.wait_for(lock, stop, interval, [] { return false; }); // wakes up at once on stop
+      }
+      flush();
+    }
+  }};
+}
+
+Logger::~Logger()
+{
+  flusher_.request_stop();
+  flusher_.join();
+  flush(); // the records logged since the last round
+}
+
+// not on the logging path: takes the lock the background thread writes with
+void Logger::addOutput(std::ostream& stream, LogFormat format)
+{
+  std::lock_guard lock{mutex_};
+  outputs_.push_back({&stream, format});
+}
+
+void Logger::addFile(std::string const& filename, LogFormat format)
+{
+  auto file = std::make_unique<std::ofstream>(filename, std::ios::binary);
+  if (!*file) {
+    throw std::runtime_error("cannot open file.");
+  }
+  std::lock_guard lock{mutex_};
+  outputs_.push_back({file.get(), format});
+  files_.push_back(std::move(file));
+}
+
+LogLevel Logger::level() const
+{
+  return level_.load(std::memory_order_relaxed);
+}
+
+void Logger::setLevel(LogLevel level)
+{
+  level_.store(level, std::memory_order_relaxed);
+}
+
+bool Logger::enabled(LogLevel level) const
+{
+  return level >= level_.load(std::memory_order_relaxed);
+}
+
+void Logger::log(LogLevel level, std::string_view message)
+{
+  if (!enabled(level)) {
+    return;
+  }
+  Record record{};
+  record.time   = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  record.level  = level;
+  record.kind   = Kind::message;
+  record.length = static_cast<unsigned char>(std::min(message.size(), max_message));
+  std::memcpy(record.text, message.data(), record.length);
+  if (!push(record)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void Logger::logState(LogLevel level, std::size_t step, double t, lotka_volterra::State const& state)
+{
+  if (!enabled(level)) {
+    return;
+  }
+  Record record{};
+  record.time  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  record.step  = step;
+  record.t     = t;
+  record.state = state;
+  record.level = level;
+  record.kind  = Kind::state;
+  if (!push(record)) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// records dropped since the last write out
+std::size_t Logger::dropped() const
+{
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+// writes out everything logged so far, on the calling thread
+void Logger::flush()
+{
+  std::lock_guard lock{mutex_};
+  write_out();
+}
+
+LogSink::LogSink(Logger& logger, Sampling const& sampling, LogLevel level)
+    : logger_{logger}
+    , sampling_{sampling}
+    , level_{level}
+    , next_time_{std::chrono::steady_clock::now()
+                 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(sampling.every_seconds))}
+{
+  if (!(sampling.every_seconds >= 0.) || !std::isfinite(sampling.every_seconds)) {
+    throw std::invalid_argument("parameter every_seconds must be finite and >= 0.");
+  }
+}
+
+void LogSink::consume(std::size_t step, double t, lotka_volterra::State const& state)
+{
+  consumeRange(step, {&t, 1}, {&state.x, 1}, {&state.y, 1}, {&state.H, 1});
+}
+
+void LogSink::consumeRange(std::size_t first, std::span<double const> t, std::span<double const> x,
+                           std::span<double const> y, std::span<double const> H)
+{
+  if (t.empty() || !logger_.enabled(level_)) {
+    return;
+  }
+  std::size_t const n = t.size();
+
+  if (std::size_t const every = sampling_.every_steps; every != 0) { // only the multiples in the chunk are visited
+    for (std::size_t step = (first + every - 1) / every * every; step < first + n; step += every) {
+      std::size_t const i = step - first;
+      logger_.logState(level_, step, t[i], {x[i], y[i], H[i]});
+    }
+  }
+
+  if (sampling_.every_seconds > 0.) { // one clock reading per chunk
+    auto const now = std::chrono::steady_clock::now();
+    if (now >= next_time_) {
+      logger_.logState(level_, first + n - 1, t[n - 1], {x[n - 1], y[n - 1], H[n - 1]});
+      next_time_ = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(sampling_.every_seconds));
+    }
+  }
+}
+} // namespace io
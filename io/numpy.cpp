@@ -0,0 +1,264 @@
+#include "numpy.hpp"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+static_assert(std::endian::native == std::endian::little, "the NumPy arrays are written as little-endian.");
+
+namespace io {
+namespace {
+// a NumPy array: dtype, storage order, shape and its data as byte ranges in storage order
+struct Array
+{
+  std::string name;
+  char const* descr; // "<f8" float64, "<u8" uint64, "|b1" bool
+  bool fortran_order;
+  std::vector<std::size_t> shape;
+  std::vector<std::span<std::byte const>> data;
+};
+
+// the ensemble state gathered from its blocks into columns
+struct EnsembleColumns
+{
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> H;
+  std::vector<double> max_rel_drift;
+  std::vector<std::uint64_t> steps;
+  std::vector<std::uint8_t> unstable;
+
+  explicit EnsembleColumns(lotka_volterra::EnsembleSimulation const& ensemble)
+  {
+    for (std::size_t i = 0; i < ensemble.size(); ++i) {
+      lotka_volterra::State const state = ensemble.stateAt(i);
+      x.push_back(state.x);
+      y.push_back(state.y);
+      H.push_back(state.H);
+      max_rel_drift.push_back(ensemble.maxRelDrift(i));
+      steps.push_back(ensemble.steps(i));
+      unstable.push_back(ensemble.isUnstable(i) ? 1 : 0);
+    }
+  }
+};
+
+// magic string, version 1.0, header length and the header dictionary, written as numpy.lib.format does:
+// padded with spaces and terminated by a newline so that the data starts at a multiple of 64 bytes
+std::string npy_header(Array const& array)
+{
+  std::string dict = std::string{"{'descr': '"} + array.descr + "', 'fortran_order': " + (array.fortran_order ? "True" : "False")
+                   + ", 'shape': (";
+  for (std::size_t i = 0; i < array.shape.size(); ++i) {
+    dict += (i == 0 ? "" : ", ") + std::to_string(array.shape[i]);
+  }
+  dict += (array.shape.size() == 1) ? ",), }" : "), }";
+
+  std::size_t const preamble = 10; // magic string, version and header length
+  dict.append(64 - (preamble + dict.size() + 1) % 64, ' ');
+  dict += '\n';
+  if (dict.size() > UINT16_MAX) {
+    throw std::runtime_error("npy header too long.");
+  }
+
+  std::string header = "\x93NUMPY\x01";
+  header += '\0';
+  header += static_cast<char>(dict.size() & 0xff);
+  header += static_cast<char>(dict.size() >> 8);
+  return header + dict;
+}
+
+void write_npy(OutputStream& file, std::string const& header, Array const& array)
+{
+  file.write(header.data(), header.size());
+  for (std::span<std::byte const> data : array.data) {
+    file.write(data.data(), data.size());
+  }
+}
+
+void output_npy(Array const& array, std::string const& filename, Compression const& compression)
+{
+  OutputStream file{filename, compression};
+  write_npy(file, npy_header(array), array);
+  file.finish();
+}
+
+// slicing-by-8 tables: crc_tables[k][b] is the crc of byte b followed by k zero bytes
+constexpr std::array<std::array<std::uint32_t, 256>, 8> crc_tables = [] {
+  std::array<std::array<std::uint32_t, 256>, 8> tables{};
+  for (std::uint32_t i = 0; i < 256; ++i) {
+    std::uint32_t c = i;
+    for (int k = 0; k < 8; ++k) {
+      c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    tables[0][i] = c;
+  }
+  for (std::size_t k = 1; k < 8; ++k) {
+    for (std::size_t i = 0; i < 256; ++i) {
+      tables[k][i] = tables[0][tables[k - 1][i] & 0xffu] ^ (tables[k - 1][i] >> 8);
+    }
+  }
+  return tables;
+}();
+
+// CRC-32 of the zip format, continued from the crc of the preceding bytes; eight bytes per iteration
+std::uint32_t crc32(std::uint32_t crc, std::span<std::byte const> data)
+{
+  auto const& t = crc_tables;
+  crc           = ~crc;
+  std::size_t i = 0;
+  for (; i + 8 <= data.size(); i += 8) {
+    std::uint32_t lo;
+    std::uint32_t hi;
+    std::memcpy(&lo, data.data() + i, 4);
+    std::memcpy(&hi, data.data() + i + 4, 4);
+    lo ^= crc;
+    crc = t[7][lo & 0xffu] ^ t[6][(lo >> 8) & 0xffu] ^ t[5][(lo >> 16) & 0xffu] ^ t[4][lo >> 24] ^ t[3][hi & 0xffu]
+        ^ t[2][(hi >> 8) & 0xffu] ^ t[1][(hi >> 16) & 0xffu] ^ t[0][hi >> 24];
+  }
+  for (; i < data.size(); ++i) {
+    crc = t[0][(crc ^ static_cast<std::uint32_t>(data[i])) & 0xffu] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void put16(std::string& out, std::size_t value)
+{
+  for (int shift = 0; shift < 16; shift += 8) {
+    out += static_cast<char>((value >> shift) & 0xff);
+  }
+}
+
+void put32(std::string& out, std::size_t value)
+{
+  for (int shift = 0; shift < 32; shift += 8) {
+    out += static_cast<char>((value >> shift) & 0xff);
+  }
+}
+
+// sizes and offsets of a zip without the zip64 extension
+std::size_t zip_size(std::size_t size)
+{
+  if (size > UINT32_MAX) {
+    throw std::runtime_error("npz archives larger than 4 GiB are not supported, use outputNPY.");
+  }
+  return size;
+}
+
+// the fields shared by the local file header and the central directory: version needed 2.0, no flags,
+// stored (no compression), 1980-01-01 00:00, crc, sizes and name length
+std::string zip_fields(std::uint32_t crc, std::size_t size, std::string const& name)
+{
+  std::string out;
+  put16(out, 20);
+  put16(out, 0);
+  put16(out, 0);
+  put16(out, 0);
+  put16(out, 0x21);
+  put32(out, crc);
+  put32(out, size);
+  put32(out, size);
+  put16(out, name.size());
+  put16(out, 0); // extra field length
+  return out;
+}
+
+void output_npz(std::vector<Array> const& arrays, std::string const& filename)
+{
+  OutputStream file{filename};
+
+  std::string central;
+  std::size_t offset = 0;
+  for (Array const& array : arrays) {
+    std::string const name   = array.name + ".npy";
+    std::string const header = npy_header(array);
+
+    std::size_t size  = header.size();
+    std::uint32_t crc = crc32(0, std::as_bytes(std::span{header}));
+    for (std::span<std::byte const> data : array.data) {
+      size += data.size();
+      crc = crc32(crc, data);
+    }
+    std::string const fields = zip_fields(crc, zip_size(size), name);
+
+    std::string local;
+    put32(local, 0x04034b50);
+    local += fields + name;
+    file.write(local.data(), local.size());
+    write_npy(file, header, array);
+
+    put32(central, 0x02014b50);
+    put16(central, 20); // version made by
+    central += fields;
+    put16(central, 0); // comment length
+    put16(central, 0); // disk number
+    put16(central, 0); // internal attributes
+    put32(central, 0); // external attributes
+    put32(central, zip_size(offset));
+    central += name;
+
+    offset += local.size() + size;
+  }
+
+  std::string end;
+  put32(end, 0x06054b50);
+  put16(end, 0); // disk number
+  put16(end, 0); // disk of the central directory
+  put16(end, arrays.size());
+  put16(end, arrays.size());
+  put32(end, central.size());
+  put32(end, zip_size(offset));
+  put16(end, 0); // comment length
+  file.write(central.data(), central.size());
+  file.write(end.data(), end.size());
+  file.finish();
+}
+} // namespace
+
+void outputNPY(lotka_volterra::TrajectoryView const& trajectory, std::string const& filename, Compression const& compression)
+{
+  output_npy({"",
+              "<f8",
+              true,
+              {trajectory.xs().size(), 4},
+              {std::as_bytes(trajectory.ts()), std::as_bytes(trajectory.xs()), std::as_bytes(trajectory.ys()),
+               std::as_bytes(trajectory.Hs())}},
+             filename, compression);
+}
+
+void outputNPY(lotka_volterra::EnsembleSimulation const& ensemble, std::string const& filename, Compression const& compression)
+{
+  EnsembleColumns const columns{ensemble};
+  output_npy({"",
+              "<f8",
+              true,
+              {ensemble.size(), 3},
+              {std::as_bytes(std::span{columns.x}), std::as_bytes(std::span{columns.y}), std::as_bytes(std::span{columns.H})}},
+             filename, compression);
+}
+
+void outputNPZ(lotka_volterra::TrajectoryView const& trajectory, std::string const& filename)
+{
+  std::array<double, 4> const pars{trajectory.getParameter(0), trajectory.getParameter(1), trajectory.getParameter(2),
+                                   trajectory.getParameter(3)};
+  std::size_t const rows = trajectory.xs().size();
+  output_npz({{"t", "<f8", false, {rows}, {std::as_bytes(trajectory.ts())}},
+              {"x", "<f8", false, {rows}, {std::as_bytes(trajectory.xs())}},
+              {"y", "<f8", false, {rows}, {std::as_bytes(trajectory.ys())}},
+              {"H", "<f8", false, {rows}, {std::as_bytes(trajectory.Hs())}},
+              {"parameters", "<f8", false, {4}, {std::as_bytes(std::span{pars})}}},
+             filename);
+}
+
+void outputNPZ(lotka_volterra::EnsembleSimulation const& ensemble, std::string const& filename)
+{
+  EnsembleColumns const columns{ensemble};
+  std::size_t const size = ensemble.size();
+  output_npz({{"x", "<f8", false, {size}, {std::as_bytes(std::span{columns.x})}},
+              {"y", "<f8", false, {size}, {std::as_bytes(std::span{columns.y})}},
+              {"H", "<f8", false, {size}, {std::as_bytes(std::span{columns.H})}},
+              {"max_rel_drift", "<f8", false, {size}, {std::as_bytes(std::span{columns.max_rel_drift})}},
+              {"steps", "<u8", false, {size}, {std::as_bytes(std::span{columns.steps})}},
+              {"unstable", "|b1", false, {size}, {std::as_bytes(std::span{columns.unstable})}}},
+             filename);
+}
+} // namespace io
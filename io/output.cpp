@@ -1,8 +1,153 @@
 #include "output.hpp"
-#include <fstream>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <thread>
 
 namespace io {
+namespace {
+constexpr std::size_t max_field = 32; // longest double with 17 significant digits is 24 characters
+
+using Columns = std::array<std::span<double const>, 4>; // t, x, y, H
+using Row     = std::array<double, 4>;                   // t, x, y, H of a state, as AsyncCSVSink buffers it
+
+void check_options(CSVOptions const& options)
+{
+  if (options.columns.empty()) {
+    throw std::invalid_argument("at least one column must be selected.");
+  }
+  if (options.precision < 0 || options.precision > 17) {
+    throw std::invalid_argument("parameter precision must be between 0 and 17.");
+  }
+  if (options.threads == 0 || options.chunk_rows == 0) {
+    throw std::invalid_argument("parameters threads, chunk_rows must be > 0.");
+  }
+}
+
+CSVOptions const& checked(CSVOptions const& options)
+{
+  check_options(options);
+  return options;
+}
+
+std::string header(CSVOptions const& options)
+{
+  constexpr std::array<char const*, 4> names{"t", "x", "y", "H"};
+
+  std::string line;
+  for (Column column : options.columns) {
+    line += line.empty() ? "" : ",";
+    line += names[static_cast<std::size_t>(column)];
+  }
+  return line + "\n";
+}
+
+// writes one row at p and returns its end; p must have room for columns * max_field characters
+char* format_row(char* p, std::array<double, 4> const& values, CSVOptions const& options)
+{
+  for (Column column : options.columns) {
+    double const value = values[static_cast<std::size_t>(column)];
+    p = (options.precision == 0) ? std::to_chars(p, p + max_field, value).ptr
+                                 : std::to_chars(p, p + max_field, value, std::chars_format::general, options.precision).ptr;
+    *p++ = ',';
+  }
+  p[-1] = '\n';
+  return p;
+}
+
+// formats rows [first, last) into out, whose storage is reused from chunk to chunk
+void format_rows(std::string& out, Columns const& data, CSVOptions const& options, std::size_t first, std::size_t last)
+{
+  LV_TRACE_SCOPE("io::format_rows");
+  out.resize((last - first) * options.columns.size() * max_field);
+  char* const begin = out.data();
+  char* p           = begin;
+  for (std::size_t i = first; i < last; ++i) {
+    p = format_row(p, {data[0][i], data[1][i], data[2][i], data[3][i]}, options);
+  }
+  out.resize(static_cast<std::size_t>(p - begin));
+}
+
+// appends the rows of a block copied by AsyncCSVSink::consume() to out
+void format_block(std::vector<char> const& block, std::vector<char>& out, CSVOptions const& options)
+{
+  LV_TRACE_SCOPE("io::format_block");
+  std::size_t const rows = block.size() / sizeof(Row);
+  std::size_t const size = out.size();
+  out.resize(size + rows * options.columns.size() * max_field);
+  char* p = out.data() + size;
+  for (std::size_t i = 0; i < rows; ++i) {
+    Row row;
+    std::memcpy(row.data(), block.data() + i * sizeof(Row), sizeof(Row));
+    p = format_row(p, row, options);
+  }
+  out.resize(static_cast<std::size_t>(p - out.data()));
+}
+} // namespace
+
+CSVSink::CSVSink(std::string const& filename, CSVOptions options)
+    : stream_{filename, options.compression}
+    , options_{std::move(options)}
+{
+  check_options(options_);
+
+  buffer_ = header(options_);
+}
+
+CSVSink::~CSVSink()
+{
+  try {
+    stream_.write(buffer_.data(), buffer_.size());
+  } catch (...) { // no throwing from the destructor
+  }
+}
+
+void CSVSink::consume(std::size_t, double t, lotka_volterra::State const& state)
+{
+  std::size_t const size = buffer_.size();
+  buffer_.resize(size + options_.columns.size() * max_field);
+  char* const end = format_row(buffer_.data() + size, {t, state.x, state.y, state.H}, options_);
+  buffer_.resize(static_cast<std::size_t>(end - buffer_.data()));
+
+  if (buffer_.size() >= (std::size_t{1} << 20)) { // large sequential writes
+    stream_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+}
+
+void CSVSink::flush()
+{
+  stream_.write(buffer_.data(), buffer_.size());
+  buffer_.clear();
+  stream_.flush();
+}
+
+AsyncCSVSink::AsyncCSVSink(std::string const& filename, CSVOptions const& options)
+    : stream_{filename, options.compression,
+              [options = checked(options), started = false](std::vector<char> const& block, std::vector<char>& out) mutable {
+                if (!started) {
+                  std::string const names = header(options);
+                  out.insert(out.end(), names.begin(), names.end());
+                  started = true;
+                }
+                format_block(block, out, options);
+              },
+              options.chunk_rows * sizeof(Row)}
+{}
+
+void AsyncCSVSink::consume(std::size_t, double t, lotka_volterra::State const& state)
+{
+  Row const row{t, state.x, state.y, state.H};
+  stream_.write(row.data(), sizeof row);
+}
+
+void AsyncCSVSink::flush()
+{
+  stream_.flush();
+}
+
 void outputStatus(lotka_volterra::Simulation const& simulation)
 {
   std::cout << "\nSimulation finished\n";
@@ -14,18 +159,80 @@ void outputStatus(lotka_volterra::Simulation const& simulation)
     std::cout << "COMPLETED\n";
   }
 }
-void outputCSV(lotka_volterra::Simulation const& simulation, std::string const& filename)
+
+void outputCSV(lotka_volterra::TrajectoryView const& trajectory, std::string const& filename, CSVOptions const& options)
 {
-  std::ofstream file(filename);
+  LV_TRACE_SCOPE("io::outputCSV");
+  check_options(options);
+  OutputStream file{filename, options.compression};
 
-  if (!file) {
-    throw std::runtime_error("cannot open file.");
+  Columns const data{trajectory.ts(), trajectory.xs(), trajectory.ys(), trajectory.Hs()};
+  std::size_t const rows = data[0].size();
+
+  std::string const names = header(options);
+  file.write(names.data(), names.size());
+
+  // rounds of `threads` chunks: the workers format round r while this thread writes round r - 1, in order
+  std::size_t const threads = options.threads;
+  std::size_t const chunk   = options.chunk_rows;
+  std::array<std::vector<std::string>, 2> buffers{std::vector<std::string>(threads), std::vector<std::string>(threads)};
+
+  std::size_t const round_rows = threads * chunk;
+  std::size_t const rounds     = (rows + round_rows - 1) / round_rows;
+  for (std::size_t r = 0; r <= rounds; ++r) {
+    std::vector<std::string>& current  = buffers[r % 2];
+    std::vector<std::string>& previous = buffers[(r + 1) % 2];
+    {
+      std::vector<std::jthread> workers;
+      for (std::size_t w = 0; r < rounds && w < threads; ++w) {
+        std::size_t const first = std::min(r * round_rows + w * chunk, rows);
+        std::size_t const last  = std::min(first + chunk, rows);
+        workers.emplace_back([&current, &data, &options, w, first, last] { format_rows(current[w], data, options, first, last); });
+      }
+
+      for (std::size_t w = 0; r > 0 && w < threads; ++w) {
+        file.write(previous[w].data(), previous[w].size());
+      }
+    } // workers join here
   }
+  file.finish();
+}
+
+// the events recorded so far in the Chrome trace_event JSON format, for chrome://tracing or Perfetto: scopes as complete
+// events and counters as counter events, times in microseconds since Trace::start(), one track per thread buffer
+void outputTrace(std::string const& filename, Compression const& compression)
+{
+  std::vector<lotka_volterra::TraceEvent> const events = lotka_volterra::Trace::events();
+  OutputStream file{filename, compression};
 
-  file << "t,x,y,H\n";
-  for (std::size_t i = 0; i < simulation.steps(); ++i) {
-    lotka_volterra::State const& state = simulation.stateAt(i);
-    file << static_cast<int>(i) * simulation.dt() << "," << state.x << "," << state.y << "," << state.H << "\n";
+  std::string line = "{\"traceEvents\":[\n";
+  char buffer[128];
+  for (std::size_t i = 0; i < events.size(); ++i) {
+    lotka_volterra::TraceEvent const& event = events[i];
+    line += "{\"name\":\"";
+    line += event.name; // literals of the trace points, nothing to escape
+    line += "\",\"cat\":\"lotka_volterra\",\"ph\":\"";
+    line += event.phase;
+    std::snprintf(buffer, sizeof buffer, "\",\"ts\":%lld.%03lld,\"pid\":1,\"tid\":%u", static_cast<long long>(event.start / 1000),
+                  static_cast<long long>(event.start % 1000), event.thread);
+    line += buffer;
+    if (event.phase == 'X') {
+      std::snprintf(buffer, sizeof buffer, ",\"dur\":%lld.%03lld}", static_cast<long long>(event.duration / 1000),
+                    static_cast<long long>(event.duration % 1000));
+    } else {
+      std::snprintf(buffer, sizeof buffer, ",\"args\":{\"value\":%.17g}}", event.value);
+    }
+    line += buffer;
+    line += (i + 1 < events.size()) ? ",\n" : "\n";
+    if (line.size() >= 65536) {
+      file.write(line.data(), line.size());
+      line.clear();
+    }
   }
+  std::snprintf(buffer, sizeof buffer, "],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":\"%zu\"}}\n",
+                lotka_volterra::Trace::dropped());
+  line += buffer;
+  file.write(line.data(), line.size());
+  file.finish();
 }
-} // namespace io
\ No newline at end of file
+} // namespace io
@@ -0,0 +1,339 @@
+#include "stream.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <zlib.h>
+#ifdef LV_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace io {
+class OutputStream::Encoder
+{
+public:
+  virtual ~Encoder() = default;
+  // compresses data, appending to out; flush makes the output decodable so far, end completes the stream
+  virtual void encode(std::vector<char> const& data, Mode mode, std::vector<char>& out) = 0;
+};
+
+namespace {
+using Mode = OutputStream::Mode;
+
+// gzip member through deflate: window bits 15 + 16 selects the gzip header and trailer
+class GzipEncoder : public OutputStream::Encoder
+{
+private:
+  z_stream z_{};
+
+public:
+  explicit GzipEncoder(int level)
+  {
+    if (deflateInit2(&z_, (level == 0) ? Z_DEFAULT_COMPRESSION : level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      throw std::runtime_error("cannot initialize gzip compression.");
+    }
+  }
+
+  GzipEncoder(GzipEncoder const&)            = delete;
+  GzipEncoder& operator=(GzipEncoder const&) = delete;
+
+  ~GzipEncoder() override
+  {
+    deflateEnd(&z_);
+  }
+
+  void encode(std::vector<char> const& data, Mode mode, std::vector<char>& out) override
+  {
+    int const flush = (mode == Mode::end) ? Z_FINISH : (mode == Mode::flush) ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+    z_.next_in      = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    z_.avail_in     = static_cast<uInt>(data.size()); // blocks are far below 4 GiB
+    for (;;) {
+      std::size_t const size = out.size();
+      uInt const room        = static_cast<uInt>(deflateBound(&z_, z_.avail_in) + 64);
+      out.resize(size + room);
+      z_.next_out      = reinterpret_cast<Bytef*>(out.data() + size);
+      z_.avail_out     = room;
+      int const result = deflate(&z_, flush);
+      out.resize(size + (room - z_.avail_out));
+      if (result == Z_STREAM_ERROR) {
+        throw std::runtime_error("gzip compression failed.");
+      }
+      if (z_.avail_in == 0 && z_.avail_out > 0 && (mode != Mode::end || result == Z_STREAM_END)) {
+        return;
+      }
+    }
+  }
+};
+
+#ifdef LV_HAVE_ZSTD
+// zstd frame through the streaming API, with the content checksum that zstd -d verifies
+class ZstdEncoder : public OutputStream::Encoder
+{
+private:
+  ZSTD_CCtx* context_;
+
+  static void check(std::size_t result)
+  {
+    if (ZSTD_isError(result)) {
+      throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(result) + ".");
+    }
+  }
+
+public:
+  explicit ZstdEncoder(int level)
+      : context_{ZSTD_createCCtx()}
+  {
+    if (context_ == nullptr) {
+      throw std::runtime_error("cannot initialize zstd compression.");
+    }
+    try {
+      check(ZSTD_CCtx_setParameter(context_, ZSTD_c_compressionLevel, (level == 0) ? ZSTD_CLEVEL_DEFAULT : level));
+      check(ZSTD_CCtx_setParameter(context_, ZSTD_c_checksumFlag, 1));
+    } catch (...) {
+      ZSTD_freeCCtx(context_);
+      throw;
+    }
+  }
+
+  ZstdEncoder(ZstdEncoder const&)            = delete;
+  ZstdEncoder& operator=(ZstdEncoder const&) = delete;
+
+  ~ZstdEncoder() override
+  {
+    ZSTD_freeCCtx(context_);
+  }
+
+  void encode(std::vector<char> const& data, Mode mode, std::vector<char>& out) override
+  {
+    ZSTD_EndDirective const directive = (mode == Mode::end) ? ZSTD_e_end : (mode == Mode::flush) ? ZSTD_e_flush : ZSTD_e_continue;
+    ZSTD_inBuffer input{data.data(), data.size(), 0};
+    for (;;) {
+      std::size_t const size = out.size();
+      out.resize(size + ZSTD_CStreamOutSize());
+      ZSTD_outBuffer output{out.data() + size, out.size() - size, 0};
+      std::size_t const remaining = ZSTD_compressStream2(context_, &output, &input, directive);
+      check(remaining);
+      out.resize(size + output.pos);
+      if (input.pos == input.size && (mode == Mode::more || remaining == 0)) {
+        return;
+      }
+    }
+  }
+};
+#endif
+} // namespace
+
+bool isAvailable(Compression::Format format)
+{
+#ifdef LV_HAVE_ZSTD
+  return format == Compression::Format::none || format == Compression::Format::gzip || format == Compression::Format::zstd;
+#else
+  return format == Compression::Format::none || format == Compression::Format::gzip;
+#endif
+}
+
+OutputStream::OutputStream(std::string const& filename, Compression const& compression)
+    : OutputStream{filename, compression, {}, block_size}
+{}
+
+OutputStream::OutputStream(std::string const& filename, Compression const& compression, Formatter formatter,
+                           std::size_t block_bytes)
+    : formatter_{std::move(formatter)}
+    , block_bytes_{block_bytes}
+{
+  if (!isAvailable(compression.format)) {
+    throw std::invalid_argument("compression format not available in this build.");
+  }
+  int const max_level = (compression.format == Compression::Format::gzip) ? 9 : 19;
+  if (compression.level < 0 || (compression.format != Compression::Format::none && compression.level > max_level)) {
+    throw std::invalid_argument("compression level out of range.");
+  }
+  if (block_bytes == 0) {
+    throw std::invalid_argument("parameter block_bytes must be > 0.");
+  }
+
+  file_.open(filename, std::ios::binary);
+  if (!file_) {
+    throw std::runtime_error("cannot open file.");
+  }
+  if (compression.format == Compression::Format::none && !formatter_) {
+    return; // written by the caller
+  }
+
+  if (compression.format == Compression::Format::gzip) {
+    encoder_ = std::make_unique<GzipEncoder>(compression.level);
+  }
+#ifdef LV_HAVE_ZSTD
+  if (compression.format == Compression::Format::zstd) {
+    encoder_ = std::make_unique<ZstdEncoder>(compression.level);
+  }
+#endif
+  block_.reserve(block_bytes_);
+  worker_ = std::thread{&OutputStream::run, this};
+}
+
+OutputStream::~OutputStream()
+{
+  try {
+    finish();
+  } catch (...) { // no throwing from the destructor
+  }
+  if (worker_.joinable()) { // finish() threw before stopping the worker
+    {
+      std::lock_guard lock{mutex_};
+      stop_ = true;
+    }
+    ready_.notify_one();
+    worker_.join();
+  }
+}
+
+// formats, compresses and writes the blocks in order, with the lock released; after an error the remaining blocks are
+// dropped
+void OutputStream::run()
+{
+  std::vector<char> formatted;
+  std::vector<char> out;
+  std::unique_lock lock{mutex_};
+  for (;;) {
+    ready_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    Block block = std::move(queue_.front());
+    queue_.pop_front();
+    bool const failed = static_cast<bool>(error_);
+    lock.unlock();
+
+    std::exception_ptr error;
+    if (!failed) {
+      try {
+        std::vector<char> const* bytes = &block.bytes;
+        if (formatter_) {
+          formatted.clear();
+          formatter_(*bytes, formatted);
+          bytes = &formatted;
+        }
+        if (encoder_) {
+          out.clear();
+          encoder_->encode(*bytes, block.mode, out);
+          bytes = &out;
+        }
+        file_.write(bytes->data(), static_cast<std::streamsize>(bytes->size()));
+        if (block.mode != Mode::more) {
+          file_.flush();
+        }
+        if (!file_) {
+          throw std::runtime_error("cannot write file.");
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+    block.bytes.clear();
+
+    lock.lock();
+    if (error) {
+      error_ = error;
+    }
+    free_.push_back(std::move(block.bytes));
+    --pending_;
+    drained_.notify_all();
+  }
+}
+
+void OutputStream::hand_over(Mode mode)
+{
+  if (block_.empty() && mode == Mode::more) {
+    return;
+  }
+  queue_.push_back({std::move(block_), mode});
+  ++pending_;
+  if (free_.empty()) {
+    block_ = std::vector<char>{};
+    block_.reserve(block_bytes_);
+  } else {
+    block_ = std::move(free_.back());
+    free_.pop_back();
+  }
+  ready_.notify_one();
+}
+
+// hands the current block over and waits until the worker has written everything
+void OutputStream::drain(Mode mode)
+{
+  std::unique_lock lock{mutex_};
+  drained_.wait(lock, [this] { return pending_ < max_blocks; });
+  hand_over(mode);
+  drained_.wait(lock, [this] { return pending_ == 0; });
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+void OutputStream::write(void const* data, std::size_t size)
+{
+  if (finished_) {
+    throw std::logic_error("output stream already finished.");
+  }
+  if (!worker_.joinable()) {
+    file_.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+    if (!file_) {
+      throw std::runtime_error("cannot write file.");
+    }
+    return;
+  }
+
+  char const* p = static_cast<char const*>(data);
+  while (size > 0) {
+    std::size_t const n = std::min(size, block_bytes_ - block_.size());
+    block_.insert(block_.end(), p, p + n);
+    p += n;
+    size -= n;
+    if (block_.size() == block_bytes_) {
+      std::unique_lock lock{mutex_};
+      drained_.wait(lock, [this] { return pending_ < max_blocks || error_; });
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+      hand_over(Mode::more);
+    }
+  }
+}
+
+void OutputStream::flush()
+{
+  if (finished_) {
+    return;
+  }
+  if (worker_.joinable()) {
+    drain(Mode::flush);
+  } else {
+    file_.flush();
+    if (!file_) {
+      throw std::runtime_error("cannot write file.");
+    }
+  }
+}
+
+void OutputStream::finish()
+{
+  if (finished_) {
+    return;
+  }
+  if (worker_.joinable()) {
+    drain(Mode::end);
+    {
+      std::lock_guard lock{mutex_};
+      stop_ = true;
+    }
+    ready_.notify_one();
+    worker_.join();
+  }
+  finished_ = true;
+  file_.close();
+  if (!file_) {
+    throw std::runtime_error("cannot write file.");
+  }
+}
+} // namespace io
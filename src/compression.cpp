@@ -0,0 +1,615 @@
+#include "compression.hpp"
+#include "simulation.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace lotka_volterra {
+namespace {
+constexpr std::size_t block_size = CompressedColumn::block_size;
+
+std::uint64_t zigzag(std::uint64_t r)
+{
+  return (r << 1) ^ (0 - (r >> 63));
+}
+
+std::uint64_t unzigzag(std::uint64_t z)
+{
+  return (z >> 1) ^ (0 - (z & 1));
+}
+
+std::size_t varint_size(std::uint64_t z)
+{
+  return static_cast<std::size_t>(std::bit_width(z | 1) + 6) / 7;
+}
+
+std::uint8_t* put_varint(std::uint64_t z, std::uint8_t* p)
+{
+  while (z >= 0x80) {
+    *p++ = static_cast<std::uint8_t>(z | 0x80);
+    z >>= 7;
+  }
+  *p++ = static_cast<std::uint8_t>(z);
+  return p;
+}
+
+[[noreturn]] void corrupted()
+{
+  throw std::runtime_error("corrupted compressed block.");
+}
+
+// the quantizer codes |q| < 2^52 as zigzag(q) + 1, at most 54 bits, and 0 for a value stored exactly
+constexpr unsigned max_width = 54;
+
+// Lorenzo prediction of order m from the last reconstructed values, last[0] the most recent
+double predict(std::array<double, 3> const& last, std::size_t m)
+{
+  switch (m) {
+  case 0:
+    return 0.;
+  case 1:
+    return last[0];
+  case 2:
+    return 2. * last[0] - last[1];
+  default:
+    return 3. * last[0] - 3. * last[1] + last[2];
+  }
+}
+
+// half step of the quantizer for a value predicted as p. The encoder and the decoder must compute it, the prediction
+// and the reconstruction with the same expressions, so that they stay bit-identical
+double half_step(ErrorBound bound, double p)
+{
+  return (bound.mode == ErrorBound::Mode::absolute) ? bound.value : bound.value * std::abs(p);
+}
+
+double reconstruct(double p, double e, double q)
+{
+  return p + 2. * e * q;
+}
+
+// nearest integer, ties to even: for |x| < 2^51, adding and subtracting 1.5 * 2^52 rounds x in the current rounding
+// mode without a library call; larger values (and NaN) go to std::nearbyint
+double round_to_integer(double x)
+{
+  constexpr double shift = 0x1.8p52; // 1.5 * 2^52: the sum has no fraction bits left
+  return (std::abs(x) < 0x1p51) ? (x + shift) - shift : std::nearbyint(x);
+}
+
+// code of v predicted as p and its reconstruction r, or 0 and r = v if the nearest step is not within the bound.
+// inverse is 1 / (2 bound) for an absolute bound, hoisted out of the loop: a rounding difference in q only ever
+// moves the value to the step next to the nearest, which the bound check rejects if it is too far
+std::uint64_t quantize(ErrorBound bound, double inverse, double v, double p, double& r)
+{
+  double const e = half_step(bound, p);
+  double const q = round_to_integer((v - p) * ((bound.mode == ErrorBound::Mode::absolute) ? inverse : 1. / (2. * e)));
+  if (std::abs(q) < 0x1p52) { // also false for NaN, from v, p or a zero step
+    double const c = reconstruct(p, e, q);
+    if (std::abs(v - c) <= ((bound.mode == ErrorBound::Mode::absolute) ? bound.value : bound.value * std::abs(v))) {
+      r = c;
+      return zigzag(static_cast<std::uint64_t>(static_cast<std::int64_t>(q))) + 1;
+    }
+  }
+  r = v;
+  return 0;
+}
+
+// codes values with the predictor of the given order, storing exactly every value whose code needs more than width
+// bits, and returns the total width of the codes, 64 for every value stored exactly
+std::size_t quantize_block(ErrorBound bound, std::span<double const> values, std::size_t order, unsigned width,
+                           std::uint64_t* codes)
+{
+  double const inverse = 1. / (2. * bound.value);
+  std::array<double, 3> last{};
+  std::size_t bits = 0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    double r;
+    std::uint64_t code = quantize(bound, inverse, values[i], predict(last, std::min(i, order)), r);
+    if (static_cast<unsigned>(std::bit_width(code)) > width) {
+      code = 0;
+      r    = values[i];
+    }
+    codes[i] = code;
+    bits += (code == 0) ? 64 : static_cast<std::size_t>(std::bit_width(code));
+    last[2] = last[1];
+    last[1] = last[0];
+    last[0] = r;
+  }
+  return bits;
+}
+} // namespace
+
+// chooses the order from the coded size of the differences of every order over the first values of the block,
+// computed in a single pass, then codes w[i], the difference of order min(i, order) at i
+void LosslessCodec::encode(std::span<double const> values, std::vector<std::uint8_t>& out) const
+{
+  constexpr std::size_t sample = 256;
+  std::size_t const n          = values.size();
+
+  std::array<std::size_t, max_order + 1> sizes{};
+  std::array<std::uint64_t, max_order> previous{}; // differences of order 0 .. max_order - 1 at i - 1
+  for (std::size_t i = 0; i < std::min(n, sample); ++i) {
+    std::uint64_t d = std::bit_cast<std::uint64_t>(values[i]);
+    for (std::size_t j = 0; j < max_order; ++j) {
+      std::uint64_t const next = d - previous[j];
+      previous[j]              = d;
+      d                        = next;
+      sizes[j + 1] += varint_size(zigzag(d)); // the first values are counted with too high an order, for every order alike
+    }
+  }
+  std::size_t const order = static_cast<std::size_t>(std::min_element(sizes.begin() + 1, sizes.end()) - sizes.begin());
+
+  std::array<std::uint64_t, block_size> w;
+  std::uint64_t* const r = w.data();
+  for (std::size_t i = 0; i < n; ++i) {
+    r[i] = std::bit_cast<std::uint64_t>(values[i]);
+  }
+  for (std::size_t k = 1; k <= order; ++k) {
+    for (std::size_t i = n; i-- > k;) {
+      r[i] -= r[i - 1];
+    }
+  }
+
+  std::size_t const size = out.size();
+  out.resize(size + 1 + 10 * n); // a varint is at most 10 bytes
+  std::uint8_t* p = out.data() + size;
+  *p++            = static_cast<std::uint8_t>(order);
+  for (std::size_t i = 0; i < n; ++i) {
+    p = put_varint(zigzag(r[i]), p);
+  }
+  out.resize(static_cast<std::size_t>(p - out.data()));
+}
+
+// decodes the first count values of a block, undoing the differences order by order with the last value of each
+void LosslessCodec::decode(std::uint8_t const* p, std::uint8_t const* end, std::size_t, std::size_t count, double* out) const
+{
+  if (p == end) {
+    corrupted();
+  }
+
+  std::size_t const order = *p++;
+  if (order == 0 || order > max_order) {
+    corrupted();
+  }
+
+  std::array<std::uint64_t, max_order> last{};
+  for (std::size_t i = 0; i < count; ++i) {
+    std::uint64_t z = 0;
+    for (int shift = 0;; shift += 7) {
+      if (p == end || shift > 63) {
+        corrupted();
+      }
+      std::uint8_t const byte = *p++;
+      z |= static_cast<std::uint64_t>(byte & 0x7fu) << shift;
+      if (byte < 0x80) {
+        break;
+      }
+    }
+
+    std::uint64_t value = unzigzag(z);
+    std::size_t const m = std::min(i, order);
+    if (m < order) {
+      last[m] = value;
+    }
+    for (std::size_t j = m; j-- > 0;) {
+      value += last[j];
+      last[j] = value;
+    }
+    out[i] = std::bit_cast<double>(value);
+  }
+}
+
+ErrorBound ErrorBound::absolute(double value)
+{
+  return {Mode::absolute, value};
+}
+
+ErrorBound ErrorBound::relative(double value)
+{
+  return {Mode::relative, value};
+}
+
+QuantizedCodec::QuantizedCodec(ErrorBound bound)
+    : bound_{bound}
+{
+  if (!(bound.value > 0.) || !std::isfinite(bound.value)) {
+    throw std::invalid_argument("error bound must be positive and finite.");
+  }
+  if (bound.mode != ErrorBound::Mode::absolute && bound.mode != ErrorBound::Mode::relative) {
+    throw std::invalid_argument("unknown error bound mode.");
+  }
+}
+
+ErrorBound QuantizedCodec::bound() const
+{
+  return bound_;
+}
+
+// chooses the order with the fewest code bits over the first values of the block, then the code width w that
+// minimizes n w + 64 (values stored exactly), and writes: order, w, the codes packed in w bits each (little endian,
+// padded with 8 bytes so that the decoder can always load a whole word), the values stored exactly
+void QuantizedCodec::encode(std::span<double const> values, std::vector<std::uint8_t>& out) const
+{
+  constexpr std::size_t sample = 256;
+  std::size_t const n          = values.size();
+
+  std::array<std::uint64_t, block_size> codes;
+  std::size_t order = 1;
+  std::size_t best  = quantize_block(bound_, values.first(std::min(n, sample)), 1, max_width, codes.data());
+  for (std::size_t k = 2; k <= max_order; ++k) {
+    std::size_t const bits = quantize_block(bound_, values.first(std::min(n, sample)), k, max_width, codes.data());
+    if (bits < best) {
+      best  = bits;
+      order = k;
+    }
+  }
+
+  quantize_block(bound_, values, order, max_width, codes.data());
+  std::array<std::size_t, max_width + 1> widths{};
+  for (std::size_t i = 0; i < n; ++i) {
+    ++widths[static_cast<std::size_t>(std::bit_width(codes[i]))];
+  }
+  unsigned top = max_width;
+  while (top > 0 && widths[top] == 0) {
+    --top;
+  }
+  unsigned width    = 0;
+  std::size_t wider = n - widths[0]; // codes wider than w, stored exactly
+  std::size_t cost  = 64 * wider;
+  for (unsigned w = 1; w <= top; ++w) {
+    wider -= widths[w];
+    if (n * w + 64 * wider < cost) {
+      cost  = n * w + 64 * wider;
+      width = w;
+    }
+  }
+  if (width < top) {
+    quantize_block(bound_, values, order, width, codes.data()); // the outliers change the reconstruction that follows
+  }
+
+  std::size_t const packed = (n * width + 7) / 8 + 8;
+  std::size_t exact        = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    exact += (codes[i] == 0);
+  }
+  std::size_t const size = out.size();
+  out.resize(size + 2 + packed + 8 * exact);
+  std::uint8_t* p = out.data() + size;
+  *p++            = static_cast<std::uint8_t>(order);
+  *p++            = static_cast<std::uint8_t>(width);
+
+  std::uint8_t* raw = p + packed;
+  std::uint64_t acc = 0;
+  unsigned filled   = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    acc |= codes[i] << filled; // filled < 8 and width <= 54: never more than 61 bits
+    filled += width;
+    for (; filled >= 8; filled -= 8) {
+      *p++ = static_cast<std::uint8_t>(acc);
+      acc >>= 8;
+    }
+    if (codes[i] == 0) {
+      std::memcpy(raw, &values[i], sizeof(double));
+      raw += sizeof(double);
+    }
+  }
+  if (filled > 0) {
+    *p++ = static_cast<std::uint8_t>(acc);
+  }
+  std::fill(p, out.data() + size + 2 + packed, std::uint8_t{0});
+}
+
+void QuantizedCodec::decode(std::uint8_t const* p, std::uint8_t const* end, std::size_t n, std::size_t count, double* out) const
+{
+  if (end - p < 2) {
+    corrupted();
+  }
+  std::size_t const order = *p++;
+  unsigned const width    = *p++;
+  std::size_t const packed = (n * width + 7) / 8 + 8;
+  if (order == 0 || order > max_order || width > max_width || static_cast<std::size_t>(end - p) < packed) {
+    corrupted();
+  }
+
+  std::uint64_t const mask = (std::uint64_t{1} << width) - 1;
+  std::uint8_t const* raw  = p + packed;
+  std::array<double, 3> last{};
+  for (std::size_t i = 0; i < count; ++i) {
+    std::size_t const bit = i * width;
+    std::uint64_t word;
+    std::memcpy(&word, p + bit / 8, sizeof word);
+    std::uint64_t const code = (word >> (bit % 8)) & mask;
+
+    double r;
+    if (code == 0) {
+      if (end - raw < 8) {
+        corrupted();
+      }
+      std::memcpy(&r, raw, sizeof r);
+      raw += sizeof r;
+    } else {
+      double const prediction = predict(last, std::min(i, order));
+      double const q          = static_cast<double>(static_cast<std::int64_t>(unzigzag(code - 1)));
+      r                       = reconstruct(prediction, half_step(bound_, prediction), q);
+    }
+    out[i]  = r;
+    last[2] = last[1];
+    last[1] = last[0];
+    last[0] = r;
+  }
+}
+
+template <class Codec>
+BlockColumn<Codec>::BlockColumn(Codec codec)
+    : codec_{std::move(codec)}
+{}
+
+template <class Codec>
+BlockColumn<Codec>::BlockColumn(std::vector<std::uint8_t> bytes, std::vector<Block> index, std::size_t size, Codec codec)
+    : codec_{std::move(codec)}
+    , bytes_{std::move(bytes)}
+    , index_{std::move(index)}
+    , sealed_{size}
+{
+  if (index_.empty() != (size == 0) || (!index_.empty() && (index_[0].first != 0 || index_[0].offset != 0))) {
+    throw std::invalid_argument("compressed column index does not match its size.");
+  }
+  for (std::size_t b = 1; b < index_.size(); ++b) {
+    if (index_[b].first <= index_[b - 1].first || index_[b].first - index_[b - 1].first > block_size
+        || index_[b].offset <= index_[b - 1].offset) {
+      throw std::invalid_argument("compressed column index is not increasing.");
+    }
+  }
+  if (!index_.empty()
+      && (index_.back().offset >= bytes_.size() || size <= index_.back().first || size - index_.back().first > block_size)) {
+    throw std::invalid_argument("compressed column index does not match its size.");
+  }
+}
+
+template <class Codec>
+std::size_t BlockColumn<Codec>::block_of(std::size_t i) const
+{
+  auto const it = std::upper_bound(index_.begin(), index_.end(), i, [](std::size_t v, Block const& b) { return v < b.first; });
+  return static_cast<std::size_t>(it - index_.begin()) - 1;
+}
+
+template <class Codec>
+std::size_t BlockColumn<Codec>::block_end(std::size_t b) const
+{
+  return (b + 1 < index_.size()) ? static_cast<std::size_t>(index_[b + 1].first) : sealed_;
+}
+
+template <class Codec>
+void BlockColumn<Codec>::decode_block(std::size_t b, std::size_t count, double* out) const
+{
+  std::uint8_t const* const p   = bytes_.data() + index_[b].offset;
+  std::uint8_t const* const end = bytes_.data() + ((b + 1 < index_.size()) ? index_[b + 1].offset : bytes_.size());
+  codec_.decode(p, end, block_end(b) - static_cast<std::size_t>(index_[b].first), count, out);
+}
+
+template <class Codec>
+Codec const& BlockColumn<Codec>::codec() const
+{
+  return codec_;
+}
+
+template <class Codec>
+void BlockColumn<Codec>::push_back(double value)
+{
+  open_.push_back(value);
+  if (open_.size() == block_size) {
+    flush();
+  }
+}
+
+template <class Codec>
+void BlockColumn<Codec>::append(std::span<double const> values)
+{
+  while (!values.empty()) {
+    std::size_t const n = std::min(values.size(), block_size - open_.size());
+    open_.insert(open_.end(), values.begin(), values.begin() + static_cast<std::ptrdiff_t>(n));
+    values = values.subspan(n);
+    if (open_.size() == block_size) {
+      flush();
+    }
+  }
+}
+
+template <class Codec>
+void BlockColumn<Codec>::flush()
+{
+  if (open_.empty()) {
+    return;
+  }
+  index_.push_back({sealed_, bytes_.size()});
+  codec_.encode(open_, bytes_);
+  sealed_ += open_.size();
+  open_.clear();
+}
+
+template <class Codec>
+std::size_t BlockColumn<Codec>::size() const
+{
+  return sealed_ + open_.size();
+}
+
+template <class Codec>
+bool BlockColumn<Codec>::empty() const
+{
+  return size() == 0;
+}
+
+template <class Codec>
+double BlockColumn<Codec>::at(std::size_t i) const
+{
+  if (i >= size()) {
+    throw std::out_of_range("compressed value index out of range.");
+  }
+  if (i >= sealed_) {
+    return open_[i - sealed_];
+  }
+
+  std::array<double, block_size> values;
+  std::size_t const b     = block_of(i);
+  std::size_t const first = static_cast<std::size_t>(index_[b].first);
+  decode_block(b, i - first + 1, values.data());
+  return values[i - first];
+}
+
+template <class Codec>
+void BlockColumn<Codec>::decode(std::size_t first, std::size_t last, std::span<double> out) const
+{
+  if (first > last || last > size() || out.size() < last - first) {
+    throw std::out_of_range("compressed value range out of range.");
+  }
+
+  std::array<double, block_size> values;
+  std::size_t i = first;
+  for (std::size_t b = (i < sealed_) ? block_of(i) : 0; i < std::min(last, sealed_); ++b) {
+    std::size_t const begin = static_cast<std::size_t>(index_[b].first);
+    std::size_t const count = std::min(block_end(b), last) - begin;
+    if (begin == i) {
+      decode_block(b, count, out.data() + (i - first)); // whole block prefix wanted, straight into out
+    } else {
+      decode_block(b, count, values.data());
+      std::copy(values.begin() + static_cast<std::ptrdiff_t>(i - begin), values.begin() + static_cast<std::ptrdiff_t>(count),
+                out.begin() + static_cast<std::ptrdiff_t>(i - first));
+    }
+    i = begin + count;
+  }
+  for (; i < last; ++i) {
+    out[i - first] = open_[i - sealed_];
+  }
+}
+
+template <class Codec>
+std::size_t BlockColumn<Codec>::compressedBytes() const
+{
+  return bytes_.size() + index_.size() * sizeof(Block) + open_.size() * sizeof(double);
+}
+
+template <class Codec>
+std::span<std::uint8_t const> BlockColumn<Codec>::bytes() const
+{
+  return bytes_;
+}
+
+template <class Codec>
+std::span<typename BlockColumn<Codec>::Block const> BlockColumn<Codec>::index() const
+{
+  return index_;
+}
+
+template class BlockColumn<LosslessCodec>;
+template class BlockColumn<QuantizedCodec>;
+
+template <class Codec>
+BlockTrajectory<Codec>::BlockTrajectory(std::size_t first_step, std::array<Codec, 4> const& codecs)
+    : first_step_{first_step}
+    , columns_{BlockColumn<Codec>{codecs[0]}, BlockColumn<Codec>{codecs[1]}, BlockColumn<Codec>{codecs[2]},
+               BlockColumn<Codec>{codecs[3]}}
+{}
+
+template <class Codec>
+BlockTrajectory<Codec>::BlockTrajectory(std::size_t first_step, std::array<BlockColumn<Codec>, 4> columns)
+    : first_step_{first_step}
+    , columns_{std::move(columns)}
+{
+  for (BlockColumn<Codec> const& column : columns_) {
+    if (column.size() != columns_[0].size()) {
+      throw std::invalid_argument("trajectory columns must have the same length.");
+    }
+  }
+}
+
+template <class Codec>
+void BlockTrajectory<Codec>::consume(std::size_t step, double t, State const& state)
+{
+  if (columns_[0].empty()) {
+    first_step_ = step;
+  } else if (step != steps()) {
+    throw std::logic_error("states must be consumed in order.");
+  }
+  columns_[0].push_back(t);
+  columns_[1].push_back(state.x);
+  columns_[2].push_back(state.y);
+  columns_[3].push_back(state.H);
+}
+
+template <class Codec>
+void BlockTrajectory<Codec>::append(std::span<double const> ts, std::span<double const> xs, std::span<double const> ys,
+                                    std::span<double const> Hs)
+{
+  if (ts.size() != xs.size() || ys.size() != xs.size() || Hs.size() != xs.size()) {
+    throw std::invalid_argument("trajectory columns must have the same length.");
+  }
+  columns_[0].append(ts);
+  columns_[1].append(xs);
+  columns_[2].append(ys);
+  columns_[3].append(Hs);
+}
+
+template <class Codec>
+void BlockTrajectory<Codec>::flush()
+{
+  for (BlockColumn<Codec>& column : columns_) {
+    column.flush();
+  }
+}
+
+template <class Codec>
+std::size_t BlockTrajectory<Codec>::firstStep() const
+{
+  return first_step_;
+}
+
+template <class Codec>
+std::size_t BlockTrajectory<Codec>::steps() const
+{
+  return first_step_ + columns_[0].size();
+}
+
+template <class Codec>
+State BlockTrajectory<Codec>::stateAt(std::size_t i) const
+{
+  if (i < first_step_ || i >= steps()) {
+    throw std::out_of_range("state " + std::to_string(i) + " is not in the compressed trajectory.");
+  }
+  return {columns_[1].at(i - first_step_), columns_[2].at(i - first_step_), columns_[3].at(i - first_step_)};
+}
+
+template <class Codec>
+double BlockTrajectory<Codec>::timeAt(std::size_t i) const
+{
+  if (i < first_step_ || i >= steps()) {
+    throw std::out_of_range("state " + std::to_string(i) + " is not in the compressed trajectory.");
+  }
+  return columns_[0].at(i - first_step_);
+}
+
+template <class Codec>
+BlockColumn<Codec> const& BlockTrajectory<Codec>::column(std::size_t i) const
+{
+  if (i > 3) {
+    throw std::out_of_range("column index out of range.");
+  }
+  return columns_[i];
+}
+
+template <class Codec>
+std::size_t BlockTrajectory<Codec>::compressedBytes() const
+{
+  std::size_t bytes = 0;
+  for (BlockColumn<Codec> const& column : columns_) {
+    bytes += column.compressedBytes();
+  }
+  return bytes;
+}
+
+template class BlockTrajectory<LosslessCodec>;
+template class BlockTrajectory<QuantizedCodec>;
+} // namespace lotka_volterra
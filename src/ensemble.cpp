@@ -0,0 +1,204 @@
+#include "ensemble.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace lotka_volterra {
+void EnsembleSimulation::check_index(std::size_t i) const
+{
+  if (i >= size_) {
+    throw std::out_of_range("system index out of range.");
+  }
+}
+
+void EnsembleSimulation::step_block(Block& block) const
+{
+  double const H_tol = 50. * dt_;
+  double const inf   = std::numeric_limits<double>::infinity();
+
+  std::array<double, lanes> x_next;
+  std::array<double, lanes> y_next;
+  std::array<double, lanes> H_next;
+
+  for (std::size_t l = 0; l < lanes; ++l) { // same operations, in the same order, as Simulation::evolve
+    double const x = block.x[l] * block.C[l] / block.D[l];
+    double const y = block.y[l] * block.B[l] / block.A[l];
+
+    double const x_rel = std::max(0., x + block.A[l] * (1 - y) * x * dt_);
+    double const y_rel = std::max(0., y + block.D[l] * (x - 1) * y * dt_);
+
+    x_next[l] = x_rel * block.D[l] / block.C[l];
+    y_next[l] = y_rel * block.A[l] / block.B[l];
+  }
+
+  for (std::size_t l = 0; l < lanes; ++l) { // scalar std::log, as Simulation::compute_H
+    double const x = x_next[l];
+    double const y = y_next[l];
+    H_next[l] = (x > 0 && y > 0) ? (-block.D[l] * std::log(x) + block.C[l] * x + block.B[l] * y - block.A[l] * std::log(y)) : inf;
+  }
+
+  for (std::size_t l = 0; l < lanes; ++l) { // per-lane masks instead of branches
+    double const rel_drift = std::abs(H_next[l] - block.H[l]) / std::abs(block.H[l]);
+
+    std::uint64_t const active = block.active[l];
+    std::uint64_t const reject = active & (block.steps[l] >= 2) & (rel_drift > H_tol);
+    std::uint64_t const accept = active & (reject ^ 1);
+
+    block.unstable[l] |= reject | (active & !std::isfinite(H_next[l]));
+    block.max_rel_drift[l] = reject ? rel_drift : block.max_rel_drift[l];
+    block.active[l]        = accept;
+    block.x[l]             = accept ? x_next[l] : block.x[l];
+    block.y[l]             = accept ? y_next[l] : block.y[l];
+    block.H[l]             = accept ? H_next[l] : block.H[l];
+    block.steps[l] += accept;
+  }
+}
+
+bool EnsembleSimulation::evolve_blocks(std::size_t first, std::size_t last, std::size_t steps)
+{
+  bool completed = true;
+
+  for (std::size_t b = first; b < last; ++b) { // each block stays in cache for all the steps
+    Block& block = blocks_[b];
+
+    for (std::size_t s = 0; s < steps; ++s) {
+      if (std::none_of(block.active.begin(), block.active.end(), [](std::uint64_t a) { return a != 0; })) {
+        break;
+      }
+      step_block(block);
+    }
+
+    for (std::size_t l = 0; l < lanes && b * lanes + l < size_; ++l) {
+      completed = completed && block.active[l] != 0;
+    }
+  }
+
+  return completed;
+}
+
+EnsembleSimulation::EnsembleSimulation(double dt, std::vector<SystemParameters> const& systems)
+    : dt_{dt}
+    , size_{systems.size()}
+    , blocks_((systems.size() + lanes - 1) / lanes)
+{
+  if (systems.empty()) {
+    throw std::invalid_argument("ensemble must contain at least one system.");
+  }
+
+  for (Block& block : blocks_) { // padding lanes stay inactive
+    block.x.fill(1.);
+    block.y.fill(1.);
+    block.H.fill(1.);
+    block.A.fill(1.);
+    block.B.fill(1.);
+    block.C.fill(1.);
+    block.D.fill(1.);
+    block.max_rel_drift.fill(0.);
+    block.steps.fill(1);
+    block.active.fill(0);
+    block.unstable.fill(0);
+  }
+
+  for (std::size_t i = 0; i < size_; ++i) {
+    SystemParameters const& p = systems[i];
+    Simulation const sim{dt, p.A, p.B, p.C, p.D, p.x0, p.y0}; // validates parameters and computes the initial H
+
+    Block& block        = blocks_[i / lanes];
+    std::size_t const l = i % lanes;
+    block.x[l]          = p.x0;
+    block.y[l]          = p.y0;
+    block.H[l]          = sim.H();
+    block.A[l]          = p.A;
+    block.B[l]          = p.B;
+    block.C[l]          = p.C;
+    block.D[l]          = p.D;
+    block.active[l]     = 1;
+    block.unstable[l]   = sim.isUnstable() ? 1 : 0;
+  }
+}
+
+double EnsembleSimulation::dt() const
+{
+  return dt_;
+}
+
+std::size_t EnsembleSimulation::size() const
+{
+  return size_;
+}
+
+State EnsembleSimulation::stateAt(std::size_t i) const
+{
+  check_index(i);
+  Block const& block = blocks_[i / lanes];
+  return {block.x[i % lanes], block.y[i % lanes], block.H[i % lanes]};
+}
+
+std::size_t EnsembleSimulation::steps(std::size_t i) const
+{
+  check_index(i);
+  return static_cast<std::size_t>(blocks_[i / lanes].steps[i % lanes]);
+}
+
+double EnsembleSimulation::maxRelDrift(std::size_t i) const
+{
+  check_index(i);
+  return blocks_[i / lanes].max_rel_drift[i % lanes];
+}
+
+bool EnsembleSimulation::isUnstable(std::size_t i) const
+{
+  check_index(i);
+  return blocks_[i / lanes].unstable[i % lanes] != 0;
+}
+
+std::size_t EnsembleSimulation::unstableCount() const
+{
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < size_; ++i) {
+    if (isUnstable(i)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+bool EnsembleSimulation::evolveSteps(std::size_t steps, std::size_t threads)
+{
+  if (threads == 0) {
+    throw std::invalid_argument("parameter threads must be > 0.");
+  }
+
+  threads                     = std::min(threads, blocks_.size());
+  std::size_t const per_block = (blocks_.size() + threads - 1) / threads;
+
+  std::vector<char> completed(threads, 1);
+  {
+    std::vector<std::jthread> workers;
+    for (std::size_t t = 1; t < threads; ++t) {
+      std::size_t const first = std::min(t * per_block, blocks_.size());
+      std::size_t const last  = std::min(first + per_block, blocks_.size());
+      workers.emplace_back([this, &completed, t, first, last, steps] { completed[t] = evolve_blocks(first, last, steps); });
+    }
+    completed[0] = evolve_blocks(0, std::min(per_block, blocks_.size()), steps);
+  } // workers join here
+
+  return std::all_of(completed.begin(), completed.end(), [](char c) { return c != 0; });
+}
+
+bool EnsembleSimulation::evolveTime(double T, std::size_t threads)
+{
+  if (T < 0) {
+    throw std::invalid_argument("parameter T must be positive.");
+  }
+
+  double n = T / dt_;
+  if (std::abs(n - std::round(n)) > 1e-8) {
+    throw std::invalid_argument("parameter T must be multiple of dt.");
+  }
+
+  return evolveSteps(static_cast<std::size_t>(std::round(n)), threads);
+}
+} // namespace lotka_volterra
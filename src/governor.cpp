@@ -0,0 +1,96 @@
+#include "governor.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace lotka_volterra {
+// late frames halve the budget down to 1/16 of its maximum, frames on time give it back 10% at a time
+void Governor::adapt_budget()
+{
+  if (frame_seconds_ > 1.1 * period_) {
+    budget_ = std::max(0.5 * budget_, max_budget_ / 16.);
+  } else {
+    budget_ = std::min(1.1 * budget_, max_budget_);
+  }
+}
+
+Governor::Governor(double frame_rate, double budget_fraction)
+{
+  if (!(frame_rate > 0.) || !std::isfinite(frame_rate)) {
+    throw std::invalid_argument("parameter frame_rate must be finite and > 0.");
+  }
+  if (!(budget_fraction > 0. && budget_fraction <= 1.)) {
+    throw std::invalid_argument("parameter budget_fraction must be in (0, 1].");
+  }
+  period_     = 1. / frame_rate;
+  max_budget_ = budget_fraction * period_;
+  budget_     = max_budget_;
+}
+
+double Governor::speed() const
+{
+  return speed_;
+}
+
+void Governor::setSpeed(double factor)
+{
+  if (!(factor >= 0.) || !std::isfinite(factor)) {
+    throw std::invalid_argument("parameter factor must be finite and >= 0.");
+  }
+  speed_  = factor;
+  synced_ = false; // the new pace starts from the current time
+}
+
+double Governor::budget() const
+{
+  return budget_;
+}
+
+// wall time between the last two frames, 0 before the second one
+double Governor::frameSeconds() const
+{
+  return frame_seconds_;
+}
+
+// smoothed rate of the integration while it runs, not of the whole loop
+double Governor::stepsPerSecond() const
+{
+  return steps_per_second_;
+}
+
+// evolves the simulation for one frame, for at most max_steps states, and returns the states added
+std::size_t Governor::frame(Simulation& simulation, std::size_t max_steps)
+{
+  Clock::time_point const now = Clock::now();
+  if (started_) {
+    frame_seconds_ = std::chrono::duration<double>(now - last_frame_).count();
+    adapt_budget();
+  }
+  last_frame_ = now;
+  started_    = true;
+
+  std::size_t allowed = max_steps;
+  if (speed_ > 0.) {
+    double const dt = simulation.dt();
+    if (!synced_) { // the pace starts from this frame
+      target_time_ = simulation.time();
+      synced_      = true;
+    } else { // a simulation that cannot keep the pace is behind by one frame at most, it does not pile up a debt
+      target_time_ = std::min(target_time_ + speed_ * frame_seconds_, simulation.time() + speed_ * frame_seconds_ + dt);
+    }
+    double const behind = (target_time_ - simulation.time()) / dt;
+    allowed             = (behind >= 1.) ? std::min(max_steps, static_cast<std::size_t>(behind)) : 0;
+  }
+  if (allowed == 0 || simulation.isUnstable()) {
+    return 0;
+  }
+
+  Clock::time_point const begin = Clock::now();
+  std::size_t const added = simulation.evolveFor(begin + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(budget_)), allowed);
+  double const elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+  if (added > 0 && elapsed > 0.) {
+    double const rate = static_cast<double>(added) / elapsed;
+    steps_per_second_ = (steps_per_second_ == 0.) ? rate : 0.8 * steps_per_second_ + 0.2 * rate;
+  }
+  return added;
+}
+} // namespace lotka_volterra
@@ -1,15 +1,234 @@
+#include "binary.hpp"
+#include "governor.hpp"
 #include "input.hpp"
+#include "log.hpp"
 #include "output.hpp"
+#include "playback.hpp"
+#include "queue.hpp"
+#include <atomic>
+#include <format>
 #include <iostream>
+#include <thread>
 
-int main()
+namespace {
+constexpr unsigned int frame_rate = 240;
+constexpr double replay_seconds   = 10.;   // default length of a whole replay
+constexpr double live_speed       = 0.;    // simulated time per second while the run is computed, 0 for as fast as possible
+constexpr double slice_rate       = 1000.; // slices of the simulation thread per second, one publish each
+constexpr double log_seconds      = 1.;    // wall time between two progress lines of the run log
+constexpr bool trace_run          = false; // records the hot paths of the run into trace.json, for Perfetto
+
+sf::RenderWindow open_window(lotka_volterra::Renderer const& ren)
+{
+  sf::ContextSettings settings;
+  settings.antialiasingLevel = 8;
+
+  return sf::RenderWindow(sf::VideoMode(static_cast<unsigned int>(ren.size()), static_cast<unsigned int>(ren.size())),
+                          "Lotka-Volterra Simulation", sf::Style::Titlebar | sf::Style::Close, settings); // not movable
+}
+
+// computes the run on a simulation thread while the window shows the states that have arrived through a lock-free
+// queue, so that the integration runs at full speed (or at live_speed) and the window at the frame rate, whatever the
+// cost of the other. Ends when the run completes or goes unstable, or when the window is closed, which stops the
+// simulation thread. Keys: space pause/resume, H show/hide the performance HUD
+void run(sf::RenderWindow& win, lotka_volterra::Renderer& ren, lotka_volterra::Simulation& sim, std::size_t max_steps)
+{
+  using Clock = std::chrono::steady_clock;
+  win.setFramerateLimit(frame_rate);
+
+  std::array<double, 4> const pars = {sim.getParameter(0), sim.getParameter(1), sim.getParameter(2), sim.getParameter(3)};
+  double const H0                  = sim.H0();
+  lotka_volterra::RendererFeed feed{ren, sim};
+  lotka_volterra::StateQueue queue;
+  std::atomic<bool> paused{false};
+  std::exception_ptr error;
+  sim.addSink(queue); // replays the first state
+
+  {
+    std::jthread simulation{[&](std::stop_token stop) { // owns sim until it is joined
+      try {
+        lotka_volterra::Governor governor{slice_rate, 1.};
+        governor.setSpeed(live_speed);
+        while (!stop.stop_requested() && !sim.isUnstable() && sim.steps() < max_steps) {
+          Clock::time_point const next = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1. / slice_rate));
+          if (paused) {
+            governor.setSpeed(live_speed); // no catching up on the pause
+          } else {
+            governor.frame(sim, max_steps - sim.steps());
+            queue.publish();
+          }
+          if (paused || live_speed > 0.) {
+            std::this_thread::sleep_until(next);
+          }
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
+      queue.finish();
+    }};
+    // on every way out of this scope, a frame that throws included: closes the queue, so the simulation thread never
+    // waits for room that the window no longer makes, joins it and only then detaches the queue from sim
+    struct Shutdown
+    {
+      std::jthread& thread;
+      lotka_volterra::StateQueue& states;
+      lotka_volterra::Simulation& source;
+      ~Shutdown()
+      {
+        states.close();
+        thread.request_stop();
+        thread.join();
+        source.removeSink(states);
+      }
+    } const shutdown{simulation, queue, sim};
+
+    std::size_t frame         = 0;
+    std::size_t last_received = 0;
+    Clock::time_point last    = Clock::now();
+    while (win.isOpen() && !queue.exhausted()) {
+      sf::Event event;
+      while (win.pollEvent(event)) {
+        if (event.type == sf::Event::Closed) {
+          win.close();
+        } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Space) {
+          paused = !paused;
+        } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::H) {
+          ren.setHud(!ren.hud());
+        }
+      }
+      queue.drain(feed); // the renderer appends only the states since the last frame
+
+      win.clear(sf::Color::White);
+      ren.draw(win, lotka_volterra::TrajectoryView{{}, {}, {}, {}, pars, H0, queue.received()});
+      win.display();
+
+      if (frame++ % (frame_rate / 4) == 0) { // four times per second
+        Clock::time_point const now = Clock::now();
+        double const rate = static_cast<double>(queue.received() - last_received) / std::chrono::duration<double>(now - last).count();
+        win.setTitle(std::format("Lotka-Volterra Simulation{} t = {:.2f}, {:.3g} steps/s", paused ? " paused" : "", queue.time(), rate));
+        ren.setHudStats({rate, queue.received(), sim.stateBytes(), 50. * sim.dt()}); // read safely while sim evolves
+        last_received = queue.received();
+        last          = now;
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// plays a stored trajectory back in the window until it is closed. Keys: space pause/resume, left/right seek by 5%,
+// home/end jump to the first/last state, up/down double/halve the speed, R reverse, T switch between states per frame
+// and simulated time per second, H show/hide the performance HUD
+void play(sf::RenderWindow& win, lotka_volterra::Renderer& ren, lotka_volterra::TrajectoryView const& trajectory, bool unstable)
+{
+  win.setFramerateLimit(frame_rate);
+
+  std::size_t const steps   = trajectory.steps();
+  double const duration     = trajectory.ts()[steps - 1] - trajectory.ts()[0];
+  double const default_step = std::max(1., static_cast<double>(steps) / (replay_seconds * frame_rate));
+  double const default_rate = duration / replay_seconds;
+
+  lotka_volterra::Playback playback{trajectory};
+  playback.setStepsPerFrame(default_step);
+  double const dt = (steps > 1) ? trajectory.ts()[1] - trajectory.ts()[0] : 0.;
+  ren.setHudStats({0., steps, 4 * steps * sizeof(double), 50. * dt}); // nothing is integrated
+
+  sf::Clock clock;
+  std::string title;
+
+  while (win.isOpen()) {
+    sf::Event event;
+    while (win.pollEvent(event)) {
+      if (event.type == sf::Event::Closed) {
+        win.close();
+      } else if (event.type == sf::Event::KeyPressed) {
+        std::size_t const jump = std::max<std::size_t>(steps / 20, 1);
+        switch (event.key.code) {
+        case sf::Keyboard::Space:
+          playback.togglePause();
+          break;
+        case sf::Keyboard::Left:
+          playback.seekStep(playback.step() - std::min(jump, playback.step()));
+          break;
+        case sf::Keyboard::Right:
+          playback.seekStep(playback.step() + jump);
+          break;
+        case sf::Keyboard::Home:
+          playback.rewind();
+          break;
+        case sf::Keyboard::End:
+          playback.seekStep(steps);
+          break;
+        case sf::Keyboard::Up:
+        case sf::Keyboard::Down: {
+          double const factor = (event.key.code == sf::Keyboard::Up) ? 2. : 0.5;
+          if (playback.mode() == lotka_volterra::Playback::Mode::steps) {
+            playback.setStepsPerFrame(playback.speed() * factor);
+          } else {
+            playback.setTimeRate(playback.speed() * factor);
+          }
+          break;
+        }
+        case sf::Keyboard::R:
+          if (playback.mode() == lotka_volterra::Playback::Mode::steps) {
+            playback.setStepsPerFrame(-playback.speed());
+          } else {
+            playback.setTimeRate(-playback.speed());
+          }
+          break;
+        case sf::Keyboard::T:
+          if (playback.mode() == lotka_volterra::Playback::Mode::steps) {
+            playback.setTimeRate(std::copysign(default_rate, playback.speed()));
+          } else {
+            playback.setStepsPerFrame(std::copysign(default_step, playback.speed()));
+          }
+          break;
+        case sf::Keyboard::H:
+          ren.setHud(!ren.hud());
+          break;
+        default:
+          break;
+        }
+      }
+    }
+    playback.advance(clock.restart().asSeconds());
+
+    win.clear(sf::Color::White);
+    playback.draw(ren, win);
+    win.display();
+
+    std::string status = "Lotka-Volterra Simulation";
+    if (playback.isPaused()) {
+      status += " paused";
+    } else if (playback.atEnd() && playback.speed() > 0.) {
+      status += unstable ? " aborted" : " complete";
+    }
+    if (status != title) { // not every frame
+      win.setTitle(status);
+      title = status;
+    }
+  }
+}
+} // namespace
+
+int main(int argc, char* argv[])
 {
   try {
+    if (argc > 1) { // replay of a stored run: project trajectory.lvt
+      io::MappedTrajectory const run{argv[1]};
+      lotka_volterra::Renderer ren = io::inputRenderer();
+      sf::RenderWindow win         = open_window(ren);
+      play(win, ren, run.view(), run.isUnstable());
+      return 0;
+    }
+
     // interactive input
     lotka_volterra::Simulation sim = io::inputSimulation();
     lotka_volterra::Renderer ren   = io::inputRenderer();
     double T                       = io::inputTime(sim);
     std::size_t const max_steps    = static_cast<std::size_t>(T / sim.dt());
+    sim.reserve(max_steps + 1); // the store never grows during the run
     // // direct input
     // lotka_volterra::Simulation sim = io::inputSimulation({0.001, 10., 6., 4., 12., 4., 3.});
     // lotka_volterra::Renderer ren   = io::inputRenderer(1000);
@@ -21,47 +240,43 @@ int main()
     // double T                    = 10.;
     // std::size_t const max_steps = static_cast<std::size_t>(std::min(T / sim.dt(), 1e7)); // total simulation steps
 
-    sf::ContextSettings settings;
-    settings.antialiasingLevel = 8;
-
-    sf::RenderWindow win(sf::VideoMode(static_cast<unsigned int>(ren.size()), static_cast<unsigned int>(ren.size())),
-                         "Lotka-Volterra Simulation", sf::Style::Titlebar | sf::Style::Close, settings);
-    win.setFramerateLimit(240);
-
-    std::size_t frame = 0;
-    bool title_set    = false;
-
-    while (win.isOpen()) {
-      sf::Event event;
-      while (win.pollEvent(event)) {
-        if (event.type == sf::Event::Closed) {
-          win.close();
-        }
-      }
-
-      win.clear(sf::Color::White);
-      if (!sim.isUnstable() && sim.steps() < max_steps && sim.evolve()) {
-        std::cout << "dt " << static_cast<double>(sim.steps()) * sim.dt() << " | H = " << sim.H() << "\n";
-        ren.draw(win, sim, frame);
-        ++frame;
-      } else {
-        ren.draw(win, sim, sim.steps() - 1);
-
-        if (!title_set) {
-          if (sim.isUnstable())
-            win.setTitle("Lotka-Volterra Simulation aborted");
-          else
-            win.setTitle("Lotka-Volterra Simulation complete");
-
-          title_set = true;
-        }
-      }
-
-      win.display();
+    // the run is computed live, then played back; closing the window stops it and keeps the states computed so far
+    sf::RenderWindow win = open_window(ren);
+    if (trace_run) {
+      lotka_volterra::Trace::start();
     }
-
+    io::Logger logger;
+    logger.addOutput(std::cout);
+    // // machine-readable log as well
+    // logger.addFile("run.jsonl", io::LogFormat::json);
+    {
+      io::AsyncCSVSink csv{"trajectory.csv"}; // written by a background thread while the simulation runs
+      io::LogSink progress{logger, {0, log_seconds}}; // replaces the progress line of every step
+      // // every step, as that line did
+      // io::LogSink progress{logger, {1, 0.}};
+      sim.addSink(csv);
+      sim.addSink(progress);
+      run(win, ren, sim, max_steps);
+      sim.removeSink(progress);
+      sim.removeSink(csv);
+      csv.flush();
+    }
+    if (sim.isUnstable()) {
+      logger.log(io::LogLevel::warning, std::format("run unstable at step {}", sim.steps()));
+    } else {
+      logger.log(io::LogLevel::info, std::format("run ended at step {}", sim.steps()));
+    }
+    logger.flush(); // before the status
     io::outputStatus(sim);
-    io::outputCSV(sim, "trajectory.csv");
+    io::outputBinary(sim, "trajectory.lvt");
+    if (trace_run) { // the simulation thread is joined
+      lotka_volterra::Trace::stop();
+      io::outputTrace("trace.json");
+    }
+
+    if (win.isOpen()) {
+      play(win, ren, sim, sim.isUnstable());
+    }
 
     return 0;
   } catch (std::exception const& e) {
@@ -71,4 +286,4 @@ int main()
     std::cerr << "Unknown fatal error.\n";
     return EXIT_FAILURE;
   }
-}
\ No newline at end of file
+}
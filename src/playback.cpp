@@ -0,0 +1,170 @@
+#include "playback.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace lotka_volterra {
+void Playback::check_speed(double speed) const
+{
+  if (!std::isfinite(speed)) {
+    throw std::invalid_argument("parameter speed must be finite.");
+  }
+}
+
+// index of the last state at or before t, 0 before the first one
+std::size_t Playback::index_at(double t) const
+{
+  auto const keyframe = std::upper_bound(keyframes_.begin(), keyframes_.end(), t, [](double time, Keyframe const& k) { return time < k.t; });
+  if (keyframe == keyframes_.begin()) {
+    return 0;
+  }
+  std::span<double const> const ts = trajectory_.ts();
+  std::size_t const first          = static_cast<std::size_t>(keyframe - keyframes_.begin() - 1) * keyframe_interval;
+  std::size_t const last           = std::min(first + keyframe_interval, ts.size());
+  auto const next = std::upper_bound(ts.begin() + static_cast<std::ptrdiff_t>(first), ts.begin() + static_cast<std::ptrdiff_t>(last), t);
+  return static_cast<std::size_t>(next - ts.begin()) - 1;
+}
+
+Playback::Playback(TrajectoryView const& trajectory)
+    : trajectory_{trajectory}
+{
+  if (trajectory.steps() == 0 || trajectory.firstStep() != 0) {
+    throw std::invalid_argument("playback needs a trajectory stored from its first state.");
+  }
+
+  std::span<double const> const ts = trajectory.ts();
+  std::span<double const> const xs = trajectory.xs();
+  std::span<double const> const ys = trajectory.ys();
+  std::size_t const n              = ts.size();
+
+  keyframes_.reserve(n / keyframe_interval + 1);
+  double max_x = 0.;
+  double max_y = 0.;
+  for (std::size_t k = 0; k < n; k += keyframe_interval) {
+    keyframes_.push_back({ts[k], max_x, max_y});
+    std::size_t const last = std::min(k + keyframe_interval, n);
+    for (std::size_t i = k; i < last; ++i) { // same scan as the renderer, so the extents are the same
+      max_x = std::max(max_x, xs[i]);
+      max_y = std::max(max_y, ys[i]);
+    }
+  }
+  clock_ = ts[0];
+}
+
+Playback::Mode Playback::mode() const
+{
+  return mode_;
+}
+
+double Playback::speed() const
+{
+  return speed_;
+}
+
+void Playback::setStepsPerFrame(double steps)
+{
+  check_speed(steps);
+  mode_     = Mode::steps;
+  speed_    = steps;
+  position_ = std::floor(position_);
+}
+
+void Playback::setTimeRate(double rate)
+{
+  check_speed(rate);
+  mode_  = Mode::time;
+  speed_ = rate; // the clock is kept by every move, also in steps mode
+}
+
+void Playback::pause()
+{
+  paused_ = true;
+}
+
+void Playback::resume()
+{
+  paused_ = false;
+}
+
+void Playback::togglePause()
+{
+  paused_ = !paused_;
+}
+
+bool Playback::isPaused() const
+{
+  return paused_;
+}
+
+bool Playback::atEnd() const
+{
+  return step() == trajectory_.steps();
+}
+
+bool Playback::atStart() const
+{
+  return step() == 1;
+}
+
+std::size_t Playback::step() const
+{
+  return static_cast<std::size_t>(position_) + 1;
+}
+
+double Playback::time() const
+{
+  return trajectory_.ts()[step() - 1];
+}
+
+// moves the position by one frame, of `seconds` of wall time in time mode
+void Playback::advance(double seconds)
+{
+  if (!(seconds >= 0.) || !std::isfinite(seconds)) {
+    throw std::invalid_argument("parameter seconds must be finite and >= 0.");
+  }
+  if (paused_) {
+    return;
+  }
+
+  std::span<double const> const ts = trajectory_.ts();
+  if (mode_ == Mode::steps) {
+    position_ = std::clamp(position_ + speed_, 0., static_cast<double>(ts.size() - 1));
+    clock_    = time();
+  } else {
+    clock_    = std::clamp(clock_ + speed_ * seconds, ts.front(), ts.back());
+    position_ = static_cast<double>(index_at(clock_));
+  }
+}
+
+void Playback::seekStep(std::size_t step)
+{
+  position_ = static_cast<double>(std::clamp<std::size_t>(step, 1, trajectory_.steps()) - 1);
+  clock_    = time();
+}
+
+void Playback::seekTime(double t)
+{
+  if (std::isnan(t)) {
+    throw std::invalid_argument("parameter t must be a number.");
+  }
+  std::span<double const> const ts = trajectory_.ts();
+  position_                        = static_cast<double>(index_at(t));
+  clock_                           = std::clamp(t, ts.front(), ts.back());
+}
+
+void Playback::rewind()
+{
+  seekStep(1);
+}
+
+void Playback::draw(Renderer& renderer, sf::RenderTarget& window)
+{
+  std::size_t const current = step();
+  std::size_t const k       = std::min(current / keyframe_interval, keyframes_.size() - 1);
+  std::size_t const first   = k * keyframe_interval;
+  if (current < drawn_ || first > drawn_) { // moved back, or forward past a keyframe: the extents restart from there
+    renderer.restoreExtents(first, keyframes_[k].max_x, keyframes_[k].max_y);
+  }
+  renderer.draw(window, trajectory_, current);
+  drawn_ = current;
+}
+} // namespace lotka_volterra
@@ -0,0 +1,107 @@
+#include "queue.hpp"
+#include "trace.hpp"
+#include <thread>
+
+namespace lotka_volterra {
+// waits until the chunk at head is free, false if the consumer closed the queue meanwhile
+bool StateQueue::wait_for_room(std::size_t head)
+{
+  while (head - tail_.load(std::memory_order_acquire) == capacity_) {
+    if (closed_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return !closed_.load(std::memory_order_relaxed);
+}
+
+StateQueue::StateQueue(std::size_t chunks)
+    : capacity_{chunks}
+{
+  if (chunks == 0) {
+    throw std::invalid_argument("parameter chunks must be > 0.");
+  }
+  ring_ = std::make_unique<Chunk[]>(chunks);
+}
+
+void StateQueue::consume(std::size_t step, double t, State const& state)
+{
+  std::size_t const head = head_.load(std::memory_order_relaxed);
+  if (filling_ == 0 && !wait_for_room(head)) {
+    return;
+  }
+
+  Chunk& chunk = ring_[head % capacity_];
+  if (filling_ == 0) {
+    chunk.first_step = step;
+  }
+  chunk.ts[filling_]     = t;
+  chunk.states[filling_] = state;
+  if (++filling_ == chunk_states) {
+    publish();
+  }
+}
+
+// makes the states so far visible to the consumer, in a partial chunk if needed
+void StateQueue::publish()
+{
+  if (filling_ == 0) {
+    return;
+  }
+  std::size_t const head      = head_.load(std::memory_order_relaxed);
+  ring_[head % capacity_].count = filling_;
+  filling_                      = 0;
+  head_.store(head + 1, std::memory_order_release);
+}
+
+// no more states: publishes the last ones
+void StateQueue::finish()
+{
+  publish();
+  finished_.store(true, std::memory_order_release);
+}
+
+// hands the states published so far to sink, in order, and frees their chunks; returns the number of states
+std::size_t StateQueue::drain(StateSink& sink)
+{
+  LV_TRACE_SCOPE("StateQueue::drain");
+  std::size_t const tail = tail_.load(std::memory_order_relaxed);
+  std::size_t const head = head_.load(std::memory_order_acquire);
+  std::size_t drained    = 0;
+  for (std::size_t i = tail; i != head; ++i) {
+    Chunk const& chunk = ring_[i % capacity_];
+    for (std::size_t k = 0; k < chunk.count; ++k) {
+      sink.consume(chunk.first_step + k, chunk.ts[k], chunk.states[k]);
+    }
+    drained += chunk.count;
+    time_ = chunk.ts[chunk.count - 1];
+    tail_.store(i + 1, std::memory_order_release); // one chunk at a time: the producer goes on meanwhile
+  }
+  received_ += drained;
+  return drained;
+}
+
+// states drained so far
+std::size_t StateQueue::received() const
+{
+  return received_;
+}
+
+// time of the last state drained
+double StateQueue::time() const
+{
+  return time_;
+}
+
+// the producer finished and every state was drained
+bool StateQueue::exhausted() const
+{
+  return finished_.load(std::memory_order_acquire) && tail_.load(std::memory_order_relaxed) == head_.load(std::memory_order_acquire);
+}
+
+// the consumer is gone: the producer drops the states from now on instead of waiting for room
+void StateQueue::close()
+{
+  closed_.store(true, std::memory_order_release);
+}
+} // namespace lotka_volterra
@@ -1,4 +1,6 @@
 #include "renderer.hpp"
+#include "trace.hpp"
+#include <algorithm>
 #include <cmath>
 #include <format>
 
@@ -19,7 +21,21 @@ void Renderer::check_set() const
   }
 }
 
-void Renderer::validate_window(sf::RenderWindow const& window) const
+void Renderer::check_step(TrajectoryView const& trajectory, std::size_t current_step) const
+{
+  if (current_step > trajectory.steps()) {
+    throw std::out_of_range("step index out of range.");
+  }
+}
+
+void Renderer::check_resident(TrajectoryView const& trajectory, std::size_t step) const
+{
+  if (step < trajectory.firstStep()) {
+    throw std::out_of_range("states to draw were evicted from the simulation history, feed the renderer with a RendererFeed.");
+  }
+}
+
+void Renderer::validate_window(sf::RenderTarget const& window) const
 {
   auto const size = window.getSize();
   if (size.x != size.y) {
@@ -93,26 +109,182 @@ double Renderer::scale(double world_max, float axis_offset, sf::View const& ui_v
   return drawableSize / static_cast<float>(world_max); 
 }
 
-void Renderer::update_trajectory(Simulation const& simulation, std::size_t current_step)
+void Renderer::update_extents(TrajectoryView const& trajectory, std::size_t current_step)
 {
-  double const H0 = simulation.stateAt(0).H; 
+  check_step(trajectory, current_step);
+
+  double const x_eq = trajectory.getParameter(3) / trajectory.getParameter(2);
+  double const y_eq = trajectory.getParameter(0) / trajectory.getParameter(1);
+
+  if (!set_ || x_eq != x_eq_ || y_eq != y_eq_) { // new parameters: equilibrium point moved
+    x_eq_         = x_eq;
+    y_eq_         = y_eq;
+    layout_dirty_ = true;
+  }
+
+  if (current_step < extent_step_) { // rewind: rescan from the first state
+    max_x_        = 0.;
+    max_y_        = 0.;
+    extent_step_  = 0;
+    layout_dirty_ = true;
+  }
+
+  if (extent_step_ == current_step) {
+    return;
+  }
+  check_resident(trajectory, extent_step_);
+
+  std::size_t const first          = trajectory.firstStep();
+  std::span<double const> const xs = trajectory.xs();
+  std::span<double const> const ys = trajectory.ys();
+
+  double max_x = max_x_;
+  double max_y = max_y_;
+  for (std::size_t i = extent_step_; i < current_step; ++i) { // only states not yet scanned
+    max_x = std::max(max_x, xs[i - first]);
+    max_y = std::max(max_y, ys[i - first]);
+  }
+  max_x_ = max_x;
+  max_y_ = max_y;
+
+  extent_step_ = current_step;
+}
+
+void Renderer::update_layout(sf::RenderTarget const& window, sf::View const& ui_view, double margin, float axis_offset)
+{
+  layout_dirty_ = layout_dirty_ || margin != margin_ || axis_offset != axis_offset_ || ui_view.getSize() != ui_size_
+               || window.getSize() != window_size_;
+  double const max_x = std::max(max_x_, x_eq_);
+  double const max_y = std::max(max_y_, y_eq_);
+  layout_dirty_      = layout_dirty_ || std::max(max_x, max_y) * margin > world_max_; // extents crossed the last tick
+
+  if (!layout_dirty_) {
+    return;
+  }
+
+  margin_          = margin;
+  ui_size_         = ui_view.getSize();
+  window_size_     = window.getSize();
+  world_max_       = max_world(margin, max_x, max_y);
+  pixels_per_unit_ = scale(world_max_, axis_offset, ui_view);
+  y0_              = ui_view.getSize().y - axis_offset;
+  tick_step_       = step_tick(margin, max_x, max_y);
+  axis_offset_     = axis_offset;
+  axis_length_     = static_cast<float>(world_max_ * pixels_per_unit_);
+
+  float const world_size = static_cast<float>(world_max_);
+  world_view_.setSize(world_size, -world_size);
+  world_view_.setCenter(world_size / 2.f, world_size / 2.f);
+
+  float const side = axis_offset_ / static_cast<float>(window_size_.x);
+  world_view_.setViewport({side, side, 1.f - 2 * side, 1.f - 2 * side});
+
+  int precision            = std::max(0, -static_cast<int>(std::floor(std::log10(tick_step_))));
+  std::string const format = "{:." + std::to_string(precision) + "f}";
+
+  tick_labels_.clear();
+  for (double pos = 0.; pos <= world_max_; pos += tick_step_) {
+    float const px = axis_offset_ + static_cast<float>(pos * pixels_per_unit_);
+    float const py = y0_ - static_cast<float>(pos * pixels_per_unit_);
+    if (px > axis_offset_ + axis_length_ || py < axis_offset_) {
+      break;
+    }
+    tick_labels_.push_back(std::vformat(format, std::make_format_args(pos)));
+  }
+
+  layout_dirty_ = false;
+}
+
+void Renderer::update_trajectory(TrajectoryView const& trajectory, std::size_t current_step)
+{
+  LV_TRACE_SCOPE("Renderer::update_trajectory");
+  check_step(trajectory, current_step);
+
+  if (current_step < last_drawn_step_) { // rewind: drop the vertices past current_step
+    trajectory_.resize(current_step);
+    last_drawn_step_ = current_step;
+  }
+
+  if (last_drawn_step_ == current_step) {
+    return;
+  }
+  check_resident(trajectory, last_drawn_step_);
+
+  std::size_t const first          = trajectory.firstStep();
+  std::span<double const> const xs = trajectory.xs();
+  std::span<double const> const ys = trajectory.ys();
+  std::span<double const> const Hs = trajectory.Hs();
+
+  double const H0 = trajectory.H0(); 
 
   for (std::size_t i = last_drawn_step_; i < current_step; ++i) { 
-    State const& state = simulation.stateAt(i);
-    trajectory_.append({{static_cast<float>(state.x), static_cast<float>(state.y)}, color_energy(state.H, H0)});
+    std::size_t const k = i - first;
+    trajectory_.append({{static_cast<float>(xs[k]), static_cast<float>(ys[k])}, color_energy(Hs[k], H0)});
   }
 
   last_drawn_step_ = current_step;
+  LV_TRACE_COUNTER("vertices", trajectory_.getVertexCount());
+
+  std::size_t const k = current_step - 1 - first; // the last state drawn, resident as checked above
+  last_H_             = Hs[k];
+  previous_H_         = (k > 0) ? Hs[k - 1] : std::numeric_limits<double>::quiet_NaN();
+}
+
+// rebuilds the HUD text and its panel from the frame times recorded so far; sf::Text keeps its vertices until the
+// string changes, so between two updates drawing the HUD is two draw calls of cached geometry
+void Renderer::update_hud()
+{
+  std::size_t const n = std::min(frame_count_, hud_frames);
+  std::array<float, hud_frames> sorted;
+  std::copy_n(frame_times_.begin(), n, sorted.begin());
+  std::sort(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(n));
+  auto const percentile = [&sorted, n](double p) {
+    return (n == 0) ? 0. : 1000. * static_cast<double>(sorted[static_cast<std::size_t>(std::lround(p * static_cast<double>(n - 1)))]);
+  };
+
+  constexpr double mib      = 1024. * 1024.;
+  double const drift        = std::abs(last_H_ - previous_H_) / std::abs(previous_H_); // NaN before two states
+  double const vertex_bytes = static_cast<double>(trajectory_.getVertexCount() * sizeof(sf::Vertex));
+
+  hud_text_.setString(std::format("frame p50 {:.1f} | p95 {:.1f} | p99 {:.1f} ms\n"
+                                  "steps/s {:.3g} | states {}\n"
+                                  "memory states {:.1f} | vertices {:.1f} MiB\n"
+                                  "dH/H {:.2e} | tolerance {:.2e}",
+                                  percentile(0.5), percentile(0.95), percentile(0.99), hud_stats_.steps_per_second,
+                                  hud_stats_.states, static_cast<double>(hud_stats_.state_bytes) / mib, vertex_bytes / mib,
+                                  drift, hud_stats_.drift_tolerance));
+  bool const warning = hud_stats_.drift_tolerance > 0. && drift > 0.5 * hud_stats_.drift_tolerance;
+  hud_text_.setFillColor(warning ? sf::Color::Red : sf::Color::Black);
+
+  constexpr float padding    = 6.f;
+  sf::FloatRect const bounds = hud_text_.getLocalBounds();
+  sf::Vector2f const corner{axis_offset_ + axis_length_ - bounds.width - 2.f * padding, axis_offset_}; // top right of the plot
+  hud_panel_.setSize({bounds.width + 2.f * padding, bounds.height + 2.f * padding + bounds.top});
+  hud_panel_.setPosition(corner);
+  hud_text_.setPosition(corner.x + padding, corner.y + padding);
 }
 
 Renderer::Renderer(std::size_t size)
     : size_{size}
+    , max_x_{0.}
+    , max_y_{0.}
 {
   check_parameter(size);
 
   if (!font_.loadFromFile("font.ttf")) {
     throw std::runtime_error("failed to load font.");
   }
+
+  label_.setFont(font_);
+  label_.setCharacterSize(label_font_size_);
+  label_.setFillColor(sf::Color::Black);
+
+  hud_text_.setFont(font_);
+  hud_text_.setCharacterSize(label_font_size_);
+  hud_text_.setFillColor(sf::Color::Black);
+  hud_panel_.setFillColor(sf::Color(255, 255, 255, 220));
+  hud_panel_.setOutlineColor(sf::Color(200, 200, 200));
+  hud_panel_.setOutlineThickness(1.f);
 }
 
 std::size_t Renderer::size() const
@@ -120,43 +292,54 @@ std::size_t Renderer::size() const
   return size_;
 }
 
-void Renderer::setDraw(sf::RenderWindow& window, Simulation const& simulation, std::size_t current_step, sf::View const& ui_view,
-                       sf::View& world_view, double margin, float axis_offset)
+void Renderer::append(std::size_t step, State const& state, double H0)
 {
-  x_eq_  = simulation.getParameter(3) / simulation.getParameter(2);
-  y_eq_  = simulation.getParameter(0) / simulation.getParameter(1);
-  max_x_ = x_eq_;
-  max_y_ = y_eq_;
-
-  for (std::size_t i = 0; i < current_step; ++i) {
-    State const& state = simulation.stateAt(i);
-    max_x_             = std::max(max_x_, state.x);
-    max_y_             = std::max(max_y_, state.y);
-  } 
-
-  world_max_       = max_world(margin, max_x_, max_y_);       
-  pixels_per_unit_ = scale(world_max_, axis_offset, ui_view); 
-  y0_              = ui_view.getSize().y - axis_offset;       
-  tick_step_       = step_tick(margin, max_x_, max_y_);
-  axis_offset_     = axis_offset;
-  axis_length_     = static_cast<float>(world_max_ * pixels_per_unit_);
+  if (step > last_drawn_step_ || step > extent_step_) {
+    throw std::logic_error("renderer feed skipped a state.");
+  }
 
-  label_.setFont(font_);
-  label_.setCharacterSize(label_font_size_);
-  label_.setFillColor(sf::Color::Black);
+  if (step == last_drawn_step_) {
+    trajectory_.append({{static_cast<float>(state.x), static_cast<float>(state.y)}, color_energy(state.H, H0)});
+    ++last_drawn_step_;
+    previous_H_ = last_H_;
+    last_H_     = state.H;
+  }
 
-  float const world_size = static_cast<float>(world_max_); 
-  world_view.setSize(world_size, -world_size);             
-  world_view.setCenter(world_size / 2.f, world_size / 2.f);
+  if (step == extent_step_) {
+    max_x_ = std::max(max_x_, state.x);
+    max_y_ = std::max(max_y_, state.y);
+    ++extent_step_;
+  }
+}
 
-  float const side = axis_offset_ / static_cast<float>(window.getSize().x);
-  world_view.setViewport({side, side, 1.f - 2 * side, 1.f - 2 * side});
+// extents of the states before step, known from elsewhere (a Playback keyframe): the next draw scans only the states
+// from step on, instead of rescanning from the first state after a rewind
+void Renderer::restoreExtents(std::size_t step, double max_x, double max_y)
+{
+  layout_dirty_ = layout_dirty_ || max_x < max_x_ || max_y < max_y_; // shrinking extents: recompute the axes
+  max_x_        = max_x;
+  max_y_        = max_y;
+  extent_step_  = step;
+}
+
+void Renderer::setDraw(sf::RenderTarget& window, TrajectoryView const& trajectory, std::size_t current_step, sf::View const& ui_view,
+                       sf::View& world_view, double margin, float axis_offset)
+{
+  LV_TRACE_SCOPE("Renderer::setDraw");
+  update_extents(trajectory, current_step);
+  update_layout(window, ui_view, margin, axis_offset);
+
+  if (label_.getFont() != &font_) { // renderer was copied or moved
+    label_.setFont(font_);
+    hud_text_.setFont(font_);
+  }
+
+  world_view = world_view_;
 
   set_ = true;
 }
 
-
-void Renderer::drawAxes(sf::RenderWindow& window, sf::View const& ui_view) const
+void Renderer::drawAxes(sf::RenderTarget& window, sf::View const& ui_view) const
 {
   check_set();
   window.setView(ui_view); 
@@ -170,34 +353,26 @@ void Renderer::drawAxes(sf::RenderWindow& window, sf::View const& ui_view) const
   window.draw(y_axis, 2, sf::Lines); 
 }
 
-void Renderer::drawTicks(sf::RenderWindow& window, sf::View const& ui_view)
+void Renderer::drawTicks(sf::RenderTarget& window, sf::View const& ui_view)
 {
+  LV_TRACE_SCOPE("Renderer::drawTicks");
   check_set();
   window.setView(ui_view); 
 
   auto const tick_color = sf::Color::Black;
   auto const grid_color = sf::Color(200, 200, 200, 100); 
 
-  int precision            = std::max(0, -static_cast<int>(std::floor(std::log10(tick_step_)))); 
-  std::string const format = "{:." + std::to_string(precision) + "f}";                           
-
-  for (double pos = 0.; pos <= world_max_; pos += tick_step_) {
+  double pos = 0.;
+  for (std::size_t i = 0; i < tick_labels_.size(); ++i, pos += tick_step_) { // labels cached by update_layout
     float const px = axis_offset_ + static_cast<float>(pos * pixels_per_unit_); 
     float const py = y0_ - static_cast<float>(pos * pixels_per_unit_);          
-    if (px > axis_offset_ + axis_length_) {
-      break;
-    } 
-    if (py < axis_offset_) {
-      break;
-    } 
 
     sf::Vertex const tick_x[] = {{{px, y0_ - 5.f}, tick_color}, {{px, y0_ + 5.f}, tick_color}};
     window.draw(tick_x, 2, sf::Lines); 
     sf::Vertex const tick_y[] = {{{axis_offset_ - 5.f, py}, tick_color}, {{axis_offset_ + 5.f, py}, tick_color}};
     window.draw(tick_y, 2, sf::Lines); 
 
-    std::string const label = std::vformat(format, std::make_format_args(pos)); 
-    label_.setString(label);
+    label_.setString(tick_labels_[i]);
     sf::FloatRect const bounds = label_.getLocalBounds();
     label_.setPosition(px - bounds.width / 2.f, y0_ + 8.f);
     window.draw(label_);
@@ -212,16 +387,16 @@ void Renderer::drawTicks(sf::RenderWindow& window, sf::View const& ui_view)
   }
 }
 
-void Renderer::drawTrajectory(sf::RenderWindow& window, Simulation const& simulation, std::size_t current_step, sf::View const& world_view)
+void Renderer::drawTrajectory(sf::RenderTarget& window, TrajectoryView const& trajectory, std::size_t current_step, sf::View const& world_view)
 {
   check_set();
   window.setView(world_view); 
-  update_trajectory(simulation, current_step);
+  update_trajectory(trajectory, current_step);
 
   window.draw(trajectory_);
 }
 
-void Renderer::drawEqPoints(sf::RenderWindow& window, sf::View const& ui_view, sf::View const& world_view) const
+void Renderer::drawEqPoints(sf::RenderTarget& window, sf::View const& ui_view, sf::View const& world_view) const
 {
   check_set();
   window.setView(world_view); 
@@ -244,7 +419,7 @@ void Renderer::drawEqPoints(sf::RenderWindow& window, sf::View const& ui_view, s
   window.draw(origin_eq_point);
 }
 
-void Renderer::drawTitles(sf::RenderWindow& window, sf::View const& ui_view) const
+void Renderer::drawTitles(sf::RenderTarget& window, sf::View const& ui_view) const
 {
   check_set();
   window.setView(ui_view); 
@@ -288,28 +463,88 @@ void Renderer::drawTitles(sf::RenderWindow& window, sf::View const& ui_view) con
   window.draw(y_title);
 }
 
-void Renderer::draw(sf::RenderWindow& window, Simulation const& simulation, std::size_t current_step)
+bool Renderer::hud() const
+{
+  return hud_;
+}
+
+// turns the HUD on or off; the frame times start over, so that they never span the time it was off
+void Renderer::setHud(bool enabled)
+{
+  hud_             = enabled;
+  frame_count_     = 0;
+  last_frame_      = {};
+  last_hud_update_ = {};
+}
+
+void Renderer::setHudStats(HudStats const& stats)
+{
+  hud_stats_ = stats;
+}
+
+// the HUD as last updated
+std::string Renderer::hudText() const
+{
+  return hud_text_.getString().toAnsiString();
+}
+
+// draws the HUD in the top right corner of the plot and records the time since the last call as a frame time; the
+// text is updated every hud_interval_ only
+void Renderer::drawHud(sf::RenderTarget& window, sf::View const& ui_view)
 {
+  LV_TRACE_SCOPE("Renderer::drawHud");
+  check_set();
+
+  Clock::time_point const now = Clock::now();
+  if (last_frame_ != Clock::time_point{}) {
+    frame_times_[frame_count_++ % hud_frames] = std::chrono::duration<float>(now - last_frame_).count();
+  }
+  last_frame_ = now;
+  if (now - last_hud_update_ >= std::chrono::duration<double>(hud_interval_)) {
+    update_hud();
+    last_hud_update_ = now;
+  }
+
+  window.setView(ui_view);
+  window.draw(hud_panel_);
+  window.draw(hud_text_);
+}
+
+void Renderer::draw(sf::RenderTarget& window, TrajectoryView const& trajectory, std::size_t current_step)
+{
+  LV_TRACE_SCOPE("Renderer::draw");
   validate_window(window);
   if (current_step == 0) {
     return;
   }
 
-  current_step = std::min(current_step, simulation.steps());
+  current_step = std::min(current_step, trajectory.steps());
 
-  sf::View world_view;
-  sf::View ui_view = window.getDefaultView();
+  sf::View const ui_view = window.getDefaultView();
 
-  setDraw(window, simulation, current_step, ui_view, world_view);
+  setDraw(window, trajectory, current_step, ui_view, world_view_);
   drawTicks(window, ui_view);
   drawAxes(window, ui_view);
-  drawTrajectory(window, simulation, current_step, world_view);
+  drawTrajectory(window, trajectory, current_step, world_view_);
   drawTitles(window, ui_view);
-  drawEqPoints(window, ui_view, world_view);
+  drawEqPoints(window, ui_view, world_view_);
+  if (hud_) {
+    drawHud(window, ui_view);
+  }
+}
+
+void Renderer::draw(sf::RenderTarget& window, TrajectoryView const& trajectory)
+{
+  draw(window, trajectory, trajectory.steps());
 }
 
-void Renderer::draw(sf::RenderWindow& window, Simulation const& simulation)
+RendererFeed::RendererFeed(Renderer& renderer, Simulation const& simulation)
+    : renderer_{renderer}
+    , H0_{simulation.H0()}
+{}
+
+void RendererFeed::consume(std::size_t step, double, State const& state)
 {
-  draw(window, simulation, simulation.steps());
+  renderer_.append(step, state, H0_);
 }
 } // namespace lotka_volterra
\ No newline at end of file
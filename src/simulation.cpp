@@ -1,13 +1,50 @@
 #include "simulation.hpp"
+#include "trace.hpp"
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <string>
 
 namespace lotka_volterra {
+void StateSink::consumeRange(std::size_t first, std::span<double const> t, std::span<double const> x,
+                             std::span<double const> y, std::span<double const> H)
+{
+  for (std::size_t i = 0; i < t.size(); ++i) {
+    consume(first + i, t[i], {x[i], y[i], H[i]});
+  }
+}
+
+template <class Method>
+void Simulation::check_dt(double dt) const
+{
+  if (dt != std::clamp(dt, Method::dt_min, Method::dt_max)) { // higher order methods support larger steps
+    throw std::invalid_argument(Method::dt_range);
+  }
+}
+
 void Simulation::check_parameters(double dt, double A, double B, double C, double D, double x0, double y0) const
 {
-  if (dt != std::clamp(dt, 0.0001, 0.01)) {
-    throw std::invalid_argument("parameter dt must be between 0.0001 and 0.01.");
+  switch (method_) {
+  case Integrator::Euler:
+    check_dt<EulerStep>(dt);
+    break;
+  case Integrator::Heun:
+    check_dt<HeunStep>(dt);
+    break;
+  case Integrator::RK4:
+    check_dt<RK4Step>(dt);
+    break;
+  case Integrator::DormandPrince:
+    check_dt<DormandPrinceStep>(dt);
+    break;
+  case Integrator::Strang:
+    check_dt<StrangSplit>(dt);
+    break;
+  case Integrator::Yoshida:
+    check_dt<YoshidaSplit>(dt);
+    break;
+  default:
+    throw std::invalid_argument("unknown integrator.");
   }
   if (A <= 0. || B <= 0. || C <= 0. || D <= 0.) {
     throw std::invalid_argument("parameters A, B, C, D must be > 0.");
@@ -17,43 +54,170 @@ void Simulation::check_parameters(double dt, double A, double B, double C, doubl
   }
 }
 
-void Simulation::integrate()
+double Simulation::compute_H(double x, double y)
 {
-  double const A = pars_[0];
-  double const D = pars_[3];
+  LV_TRACE_SCOPE("Simulation::compute_H");
+  double H = energy(x, y);
+  if (!std::isfinite(H)) {
+    unstable_ = true;
+  }
+  return H;
+}
 
-  double const x = x_rel_; 
-  double const y = y_rel_; 
+void Simulation::push_states(std::span<double const> t, std::span<double const> x, std::span<double const> y,
+                             std::span<double const> H)
+{
+  LV_TRACE_SCOPE("Simulation::push_states"); // store and sinks
+  std::size_t const first = steps();
 
-  double const x_next = x + A * (1 - y) * x * dt_; 
-  double const y_next = y + D * (x - 1) * y * dt_; 
+  states_.append(t, x, y, H);
 
-  x_rel_ = std::max(0., x_next);
-  y_rel_ = std::max(0., y_next);
+  if (history_ != 0 && states_.size() >= 2 * history_) {
+    evict();
+  }
+
+  for (StateSink* sink : sinks_) {
+    sink->consumeRange(first, t, x, y, H);
+  }
 }
 
-double Simulation::compute_H(double x, double y)
+void Simulation::push_state(double t, double x, double y, double H)
 {
-  double const A = pars_[0];
-  double const B = pars_[1];
-  double const C = pars_[2];
-  double const D = pars_[3];
+  states_.push_back(t, x, y, H);
 
-  double H = (x > 0 && y > 0) ? (-D * std::log(x) + C * x + B * y - A * std::log(y)) : std::numeric_limits<double>::infinity();
-  if (!std::isfinite(H)) {
-    unstable_ = true;
+  if (history_ != 0 && states_.size() >= 2 * history_) {
+    evict();
   }
-  return H;
+
+  State const state{x, y, H};
+  for (StateSink* sink : sinks_) {
+    sink->consume(steps() - 1, t, state);
+  }
+}
+
+void Simulation::evict()
+{
+  if (history_ == 0 || states_.size() <= history_) {
+    return;
+  }
+
+  std::size_t const n = states_.size() - history_; // drop the oldest, amortized O(1) per step
+  if (compressed_) {
+    archive_.append(states_.ts().first(n), states_.xs().first(n), states_.ys().first(n), states_.Hs().first(n));
+  }
+  states_.eraseFront(n);
+  first_step_ += n;
 }
 
-Simulation::Simulation(double dt, double A, double B, double C, double D, double x0, double y0)
+// the evolve_steps buffers: allocated on the first call and only grown, as evolveFor() calls it every few steps
+std::span<double> Simulation::scratch(std::size_t size)
+{
+  if (scratch_.size() < size) {
+    scratch_.resize(size);
+  }
+  return {scratch_.data(), size};
+}
+
+Simulation::Simulation(double dt, double A, double B, double C, double D, double x0, double y0, Integrator method)
     : dt_{dt}
     , x_rel_{x0 * C / D}
     , y_rel_{y0 * B / A}
+    , u_{std::log(x_rel_)}
+    , v_{std::log(y_rel_)}
+    , H_offset_{-D * std::log(D / C) - A * std::log(A / B)}
     , pars_{{A, B, C, D}}
+    , method_{method}
 {
   check_parameters(dt, A, B, C, D, x0, y0);
-  states_.push_back({x0, y0, compute_H(x0, y0)});
+  H0_ = compute_H(x0, y0);
+  push_state(0., x0, y0, H0_);
+}
+
+double Simulation::energy(double x, double y) const
+{
+  double const A = pars_[0];
+  double const B = pars_[1];
+  double const C = pars_[2];
+  double const D = pars_[3];
+
+  return (x > 0 && y > 0) ? (-D * std::log(x) + C * x + B * y - A * std::log(y)) : std::numeric_limits<double>::infinity();
+}
+
+std::size_t Simulation::chunkSize() const
+{
+  return chunk_size_;
+}
+
+void Simulation::setChunkSize(std::size_t chunk_size)
+{
+  if (chunk_size == 0) {
+    throw std::invalid_argument("parameter chunk_size must be > 0.");
+  }
+  chunk_size_ = chunk_size;
+}
+
+double Simulation::rtol() const
+{
+  return rtol_;
+}
+
+double Simulation::atol() const
+{
+  return atol_;
+}
+
+void Simulation::setTolerances(double rtol, double atol)
+{
+  if (rtol <= 0. || atol <= 0.) {
+    throw std::invalid_argument("parameters rtol, atol must be > 0.");
+  }
+  rtol_ = rtol;
+  atol_ = atol;
+}
+
+std::size_t Simulation::rhsEvaluations() const
+{
+  return rhs_evaluations_;
+}
+
+// a copy starts with no sinks: they were attached to the original, which still forwards its states to them
+Simulation::Simulation(Simulation const& other)
+    : dt_{other.dt_}
+    , x_rel_{other.x_rel_}
+    , y_rel_{other.y_rel_}
+    , u_{other.u_}
+    , v_{other.v_}
+    , H_offset_{other.H_offset_}
+    , pars_{other.pars_}
+    , method_{other.method_}
+    , states_{other.states_}
+    , archive_{other.archive_}
+    , H0_{other.H0_}
+    , max_rel_drift_{other.max_rel_drift_}
+    , rtol_{other.rtol_}
+    , atol_{other.atol_}
+    , h_{other.h_}
+    , rhs_evaluations_{other.rhs_evaluations_}
+    , first_step_{other.first_step_}
+    , history_{other.history_}
+    , chunk_size_{other.chunk_size_}
+    , unstable_{other.unstable_}
+    , compressed_{other.compressed_}
+{
+}
+
+// the sinks of this simulation are detached as well, since they followed the states it replaces
+Simulation& Simulation::operator=(Simulation const& other)
+{
+  if (this != &other) {
+    *this = Simulation{other};
+  }
+  return *this;
+}
+
+Integrator Simulation::method() const
+{
+  return method_;
 }
 
 double Simulation::dt() const
@@ -61,9 +225,19 @@ double Simulation::dt() const
   return dt_;
 }
 
+double Simulation::time() const
+{
+  return states_.ts().back();
+}
+
 double Simulation::H() const
 {
-  return states_.back().H;
+  return states_.Hs().back();
+}
+
+double Simulation::H0() const
+{
+  return H0_;
 }
 
 double Simulation::maxRelDrift() const
@@ -81,35 +255,167 @@ double const& Simulation::getParameter(std::size_t i) const
 
 std::size_t Simulation::steps() const
 {
-  return states_.size();
+  return first_step_ + states_.size();
 }
 
-State const& Simulation::stateAt(std::size_t i) const
+std::size_t Simulation::firstStep() const
 {
-  return states_.at(i);
+  return first_step_;
 }
 
-bool Simulation::evolve()
+std::size_t Simulation::history() const
+{
+  return history_;
+}
+
+// memory of the resident states, safe to call while another thread evolves the simulation
+std::size_t Simulation::stateBytes() const
+{
+  return states_.bytes();
+}
+
+// capacity hint: room for `states` resident states, so that the store does not grow (and copy them) until then
+void Simulation::reserve(std::size_t states)
+{
+  states_.reserve(states);
+}
+
+void Simulation::setHistory(std::size_t capacity)
+{
+  if (capacity == 0) {
+    throw std::invalid_argument("parameter capacity must be > 0.");
+  }
+  history_ = capacity;
+  evict();
+  states_.reserve(2 * capacity + chunk_size_); // the most a bounded history holds before an eviction
+}
+
+void Simulation::setCompressedHistory(std::size_t resident)
+{
+  if (resident == 0) {
+    throw std::invalid_argument("parameter resident must be > 0.");
+  }
+  if (!compressed_) {
+    archive_    = CompressedTrajectory{first_step_};
+    compressed_ = true;
+  }
+  setHistory(resident);
+}
+
+bool Simulation::isCompressed() const
+{
+  return compressed_;
+}
+
+CompressedTrajectory const& Simulation::archive() const
+{
+  return archive_;
+}
+
+void Simulation::addSink(StateSink& sink)
+{
+  std::span<double const> const ts = states_.ts();
+  std::span<double const> const xs = states_.xs();
+  std::span<double const> const ys = states_.ys();
+  std::span<double const> const Hs = states_.Hs();
+  for (std::size_t i = 0; i < ts.size(); ++i) { // replay the resident states first
+    sink.consume(first_step_ + i, ts[i], {xs[i], ys[i], Hs[i]});
+  }
+  sinks_.push_back(&sink);
+}
+
+void Simulation::removeSink(StateSink& sink)
+{
+  std::erase(sinks_, &sink);
+}
+
+State Simulation::stateAt(std::size_t i) const
+{
+  if (compressed_ && i >= archive_.firstStep() && i < first_step_) {
+    return archive_.stateAt(i);
+  }
+  if (i < first_step_) {
+    throw std::out_of_range("state " + std::to_string(i) + " was evicted from the bounded history (first resident state is "
+                            + std::to_string(first_step_) + ").");
+  }
+  if (i >= steps()) {
+    throw std::out_of_range("state index out of range.");
+  }
+  return {states_.xs()[i - first_step_], states_.ys()[i - first_step_], states_.Hs()[i - first_step_]};
+}
+
+double Simulation::timeAt(std::size_t i) const
+{
+  if (compressed_ && i >= archive_.firstStep() && i < first_step_) {
+    return archive_.timeAt(i);
+  }
+  stateAt(i); // same range checks
+  return states_.ts()[i - first_step_];
+}
+
+std::span<double const> Simulation::ts() const
+{
+  return states_.ts();
+}
+
+std::span<double const> Simulation::xs() const
+{
+  return states_.xs();
+}
+
+std::span<double const> Simulation::ys() const
+{
+  return states_.ys();
+}
+
+std::span<double const> Simulation::Hs() const
+{
+  return states_.Hs();
+}
+
+template <class Method>
+bool Simulation::evolve_one()
 {
   double const A = pars_[0];
   double const B = pars_[1];
   double const C = pars_[2];
   double const D = pars_[3];
 
-  State const& curr_state = states_.back();
-  x_rel_                  = curr_state.x * C / D; 
-  y_rel_                  = curr_state.y * B / A; 
+  double const H_curr = states_.Hs().back();
+  double x_next;
+  double y_next;
+  double H_next;
+  double u  = u_;
+  double v  = v_;
+
+  if constexpr (Method::log_coordinates) { // no clamping and no logs, H follows from u, v, e^u, e^v
+    double eu;
+    double ev = std::exp(v);
+    Method::step(u, v, eu, ev, A, D, dt_);
+    rhs_evaluations_ += Method::stages;
 
-  integrate();
+    x_next = eu * D / C;
+    y_next = ev * A / B;
+    H_next = D * (eu - u) + A * (ev - v) + H_offset_;
+    if (!std::isfinite(H_next)) {
+      unstable_ = true;
+    }
+  } else {
+    x_rel_ = states_.xs().back() * C / D; 
+    y_rel_ = states_.ys().back() * B / A; 
 
-  double x_next = x_rel_ * D / C; 
-  double y_next = y_rel_ * A / B; 
+    Method::step(x_rel_, y_rel_, A, D, dt_);
+    rhs_evaluations_ += Method::stages;
 
-  double H_next = compute_H(x_next, y_next);
+    x_next = x_rel_ * D / C; 
+    y_next = y_rel_ * A / B; 
 
-  if (states_.size() >= 2) {
-    double const H_tol = 50. * dt_;                                                
-    double rel_drift   = std::abs(H_next - curr_state.H) / std::abs(curr_state.H); 
+    H_next = compute_H(x_next, y_next);
+  }
+
+  if (steps() >= 2) {
+    double const H_tol = 50. * dt_;                                        
+    double rel_drift   = std::abs(H_next - H_curr) / std::abs(H_curr); 
 
     if (rel_drift > H_tol) {
       unstable_      = true;
@@ -117,16 +423,298 @@ bool Simulation::evolve()
       return false;
     }
   }
-  states_.push_back({x_next, y_next, H_next});
+  u_ = u;
+  v_ = v;
+  push_state(static_cast<double>(steps()) * dt_, x_next, y_next, H_next);
+  return true;
+}
+
+template <class Method>
+bool Simulation::evolve_steps(std::size_t add_steps)
+{
+  double const A     = pars_[0];
+  double const B     = pars_[1];
+  double const C     = pars_[2];
+  double const D     = pars_[3];
+  double const x_to  = D / C; // reciprocals of the scaling factors, computed once
+  double const y_to  = A / B;
+  double const H_tol = 50. * dt_;
+
+  std::size_t const chunk = std::min(chunk_size_, add_steps);
+  std::span<double> const buffer = scratch((Method::log_coordinates ? 9 : 7) * chunk);
+  std::span<double> const x_rel_buf{buffer.data(), chunk};
+  std::span<double> const y_rel_buf{buffer.data() + chunk, chunk};
+  std::span<double> const x_buf{buffer.data() + 2 * chunk, chunk};
+  std::span<double> const y_buf{buffer.data() + 3 * chunk, chunk};
+  std::span<double> const H_buf{buffer.data() + 4 * chunk, chunk};
+  std::span<double> const drift_buf{buffer.data() + 5 * chunk, chunk};
+  std::span<double> const t_buf{buffer.data() + 6 * chunk, chunk};
+  std::span<double> const u_buf{buffer.data() + 7 * chunk, Method::log_coordinates ? chunk : 0};
+  std::span<double> const v_buf{buffer.data() + 8 * chunk, Method::log_coordinates ? chunk : 0};
+
+  double x_rel  = states_.xs().back() * C / D; // the state stays in scaled coordinates across steps
+  double y_rel  = states_.ys().back() * B / A;
+  double u      = u_;
+  double v      = v_;
+  double H_curr = states_.Hs().back();
+  if constexpr (Method::log_coordinates) {
+    y_rel = std::exp(v);
+  }
+
+  for (std::size_t done = 0; done < add_steps;) {
+    std::size_t const n = std::min(chunk, add_steps - done);
+    LV_TRACE_SCOPE("Simulation::evolve");
+    LV_TRACE_COUNTER("states", steps());
+
+    for (std::size_t i = 0; i < n; ++i) { // integrate the whole chunk: the only serial dependency
+      if constexpr (Method::log_coordinates) {
+        Method::step(u, v, x_rel, y_rel, A, D, dt_); // x_rel, y_rel are e^u, e^v
+        u_buf[i] = u;
+        v_buf[i] = v;
+      } else {
+        Method::step(x_rel, y_rel, A, D, dt_); // inlined policy, no dispatch inside the loop
+      }
+      x_rel_buf[i] = x_rel;
+      y_rel_buf[i] = y_rel;
+    }
+    rhs_evaluations_ += Method::stages * n;
+
+    for (std::size_t i = 0; i < n; ++i) {
+      x_buf[i] = x_rel_buf[i] * x_to;
+      y_buf[i] = y_rel_buf[i] * y_to;
+    }
+
+    if constexpr (Method::log_coordinates) { // u and v are already there, no logs at all
+      for (std::size_t i = 0; i < n; ++i) {
+        H_buf[i] = D * (x_rel_buf[i] - u_buf[i]) + A * (y_rel_buf[i] - v_buf[i]) + H_offset_;
+      }
+    } else {
+      LV_TRACE_SCOPE("Simulation::compute_H"); // for the whole chunk
+      for (std::size_t i = 0; i < n; ++i) { // independent logs, no longer behind the integration
+        H_buf[i] = energy(x_buf[i], y_buf[i]);
+      }
+    }
+
+    std::size_t const base = steps();
+    std::size_t rejected   = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      double const H_prev = (i == 0) ? H_curr : H_buf[i - 1];
+      drift_buf[i]        = std::abs(H_buf[i] - H_prev) / std::abs(H_prev);
+      rejected += static_cast<std::size_t>(base + i >= 2 && drift_buf[i] > H_tol);
+    }
+
+    std::size_t accepted = n;
+    if (rejected != 0) { // roll back to the first offending step
+      accepted = 0;
+      while (base + accepted < 2 || !(drift_buf[accepted] > H_tol)) {
+        ++accepted;
+      }
+    }
+
+    for (std::size_t i = 0; i < accepted; ++i) {
+      if (!std::isfinite(H_buf[i])) {
+        unstable_ = true;
+        break;
+      }
+    }
+    for (std::size_t i = 0; i < accepted; ++i) { // times from the step index, no accumulated rounding
+      t_buf[i] = static_cast<double>(base + i) * dt_;
+    }
+    push_states(t_buf.first(accepted), x_buf.first(accepted), y_buf.first(accepted), H_buf.first(accepted));
+
+    if (accepted != n) {
+      unstable_      = true;
+      max_rel_drift_ = drift_buf[accepted];
+      if (accepted != 0) {
+        x_rel_ = x_rel_buf[accepted - 1];
+        y_rel_ = y_rel_buf[accepted - 1];
+        if constexpr (Method::log_coordinates) {
+          u_ = u_buf[accepted - 1];
+          v_ = v_buf[accepted - 1];
+        }
+      }
+      return false;
+    }
+
+    H_curr = H_buf[n - 1];
+    done += n;
+  }
+
+  x_rel_ = x_rel;
+  y_rel_ = y_rel;
+  u_     = u;
+  v_     = v;
+  return true;
+}
+
+bool Simulation::evolve_grid(std::span<double const> times)
+{
+  using DP = DormandPrinceStep;
+
+  double const A    = pars_[0];
+  double const B    = pars_[1];
+  double const C    = pars_[2];
+  double const D    = pars_[3];
+  double const x_to = D / C;
+  double const y_to = A / B;
+
+  std::size_t const n = times.size();
+
+  std::vector<double> buffer(4 * n);
+  std::span<double> const x_buf{buffer.data(), n};
+  std::span<double> const y_buf{buffer.data() + n, n};
+  std::span<double> const H_buf{buffer.data() + 2 * n, n};
+  std::span<double> const drift_buf{buffer.data() + 3 * n, n};
+
+  double t     = states_.ts().back();
+  double x_rel = states_.xs().back() * C / D;
+  double y_rel = states_.ys().back() * B / A;
+  double kx;
+  double ky;
+  DP::rhs(x_rel, y_rel, A, D, kx, ky);
+  ++rhs_evaluations_;
+
+  double h = h_;
+  if (h <= 0.) { // initial guess from the scale of the solution and of its derivative (Hairer, Norsett, Wanner)
+    double const sx = atol_ + rtol_ * std::abs(x_rel);
+    double const sy = atol_ + rtol_ * std::abs(y_rel);
+    double const d0 = std::hypot(x_rel / sx, y_rel / sy);
+    double const d1 = std::hypot(kx / sx, ky / sy);
+    h               = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+  }
+
+  // integrate up to the last output time, interpolating the intermediate ones
+  double const t_end = times.back();
+  std::size_t out    = 0;
+  bool rejected      = false;
+  while (out < n) {
+    bool const last   = h >= t_end - t; // the last step is shortened to land on t_end
+    double const step = last ? t_end - t : h;
+    if (!(step > 1e-12 * std::max(1., std::abs(t)))) { // step size underflow
+      break;
+    }
+
+    DP::Trial const trial = DP::step(x_rel, y_rel, kx, ky, A, D, step, rtol_, atol_);
+    rhs_evaluations_ += DP::stages;
+
+    if (!(trial.err <= 1.)) { // also rejects non-finite errors
+      h        = step * std::max(0.2, 0.9 * std::pow(trial.err, -0.2));
+      rejected = true;
+      continue;
+    }
+
+    double const t_next = last ? t_end : t + step;
+    for (; out < n && times[out] <= t_next; ++out) { // dense output
+      double const theta = (times[out] - t) / step;
+      x_buf[out]         = (theta < 1. ? DP::interpolate(trial.cx, theta) : trial.x) * x_to;
+      y_buf[out]         = (theta < 1. ? DP::interpolate(trial.cy, theta) : trial.y) * y_to;
+    }
+
+    double const factor = std::min(rejected ? 1. : 10., 0.9 * std::pow(std::max(trial.err, 1e-10), -0.2));
+    h                   = last ? std::max(h, step * factor) : step * factor;
+    rejected            = false;
+
+    t     = t_next;
+    x_rel = trial.x;
+    y_rel = trial.y;
+    kx    = trial.kx;
+    ky    = trial.ky;
+  }
+  h_ = h;
+
+  for (std::size_t i = 0; i < out; ++i) {
+    H_buf[i] = energy(x_buf[i], y_buf[i]);
+  }
+
+  // same drift check as the fixed step kernels, with the tolerance scaled by the output interval and capped by the
+  // error control: 5% (what the fixed step kernels allow at dt = 0.001) or 100 rtol for looser tolerances, so that a
+  // wide interval no longer lets through a drift of 50 times its length
+  double const max_H_tol = std::max(0.05, 100. * rtol_);
+  std::size_t const base = steps();
+  std::size_t accepted   = out;
+  for (std::size_t i = 0; i < out; ++i) {
+    double const H_prev = (i == 0) ? states_.Hs().back() : H_buf[i - 1];
+    double const t_prev = (i == 0) ? states_.ts().back() : times[i - 1];
+    double const H_tol  = std::min(50. * (times[i] - t_prev), max_H_tol);
+    drift_buf[i]        = std::abs(H_buf[i] - H_prev) / std::abs(H_prev);
+    if (base + i >= 2 && drift_buf[i] > H_tol) {
+      accepted = i;
+      break;
+    }
+  }
+
+  for (std::size_t i = 0; i < accepted; ++i) {
+    if (!std::isfinite(H_buf[i])) {
+      unstable_ = true;
+      break;
+    }
+  }
+  push_states(times.first(accepted), x_buf.first(accepted), y_buf.first(accepted), H_buf.first(accepted));
+
+  if (accepted != n) {
+    unstable_ = true;
+    if (accepted != out) {
+      max_rel_drift_ = drift_buf[accepted];
+    }
+    return false;
+  }
+
+  x_rel_ = x_rel;
+  y_rel_ = y_rel;
   return true;
 }
 
+bool Simulation::evolve()
+{
+  LV_TRACE_SCOPE("Simulation::evolve");
+  switch (method_) {
+  case Integrator::Heun:
+    return evolve_one<HeunStep>();
+  case Integrator::RK4:
+    return evolve_one<RK4Step>();
+  case Integrator::Strang:
+    return evolve_one<StrangSplit>();
+  case Integrator::Yoshida:
+    return evolve_one<YoshidaSplit>();
+  case Integrator::DormandPrince: {
+    double const t = states_.ts().back() + dt_;
+    return evolve_grid({&t, 1});
+  }
+  default:
+    return evolve_one<EulerStep>();
+  }
+}
+
 bool Simulation::evolveSteps(std::size_t add_steps)
-{ 
-  for (std::size_t i = 0; i < add_steps; ++i) {
-    if (!evolve()) {
+{
+  switch (method_) { // the method is selected once per call, the kernel is instantiated per policy
+  case Integrator::Heun:
+    return evolve_steps<HeunStep>(add_steps);
+  case Integrator::RK4:
+    return evolve_steps<RK4Step>(add_steps);
+  case Integrator::Strang:
+    return evolve_steps<StrangSplit>(add_steps);
+  case Integrator::Yoshida:
+    return evolve_steps<YoshidaSplit>(add_steps);
+  case Integrator::DormandPrince:
+    break;
+  default:
+    return evolve_steps<EulerStep>(add_steps);
+  }
+
+  // adaptive mode: dt is the output interval, the uniform grid is built chunk by chunk
+  double const t0 = states_.ts().back();
+  std::vector<double> times;
+  for (std::size_t done = 0; done < add_steps;) {
+    std::size_t const n = std::min(chunk_size_, add_steps - done);
+    times.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      times[i] = t0 + static_cast<double>(done + i + 1) * dt_;
+    }
+    if (!evolve_grid(times)) {
       return false;
     }
+    done += n;
   }
   return true;
 }
@@ -146,8 +734,123 @@ bool Simulation::evolveTime(double T)
   return evolveSteps(steps);
 }
 
+// evolves until the deadline, for at most max_steps states or until the run goes unstable, and returns the states
+// added. The clock is read between batches, not every step: the first batch is small and measures the cost of a
+// step, each next one takes about half of the remaining time, so the deadline is overshot by one small batch at most
+std::size_t Simulation::evolveFor(std::chrono::steady_clock::time_point deadline, std::size_t max_steps)
+{
+  using Clock                     = std::chrono::steady_clock;
+  constexpr std::size_t min_batch = 16;
+
+  std::size_t const start = steps();
+  std::size_t batch       = min_batch;
+  Clock::time_point now   = Clock::now();
+  while (now < deadline && !unstable_ && steps() - start < max_steps) {
+    std::size_t const n           = std::min(batch, max_steps - (steps() - start));
+    Clock::time_point const begin = now;
+    evolveSteps(n);
+    now = Clock::now();
+
+    double const per_step  = std::chrono::duration<double>(now - begin).count() / static_cast<double>(n);
+    double const remaining = std::chrono::duration<double>(deadline - now).count();
+    double const fit       = (per_step > 0.) ? 0.5 * remaining / per_step : 2. * static_cast<double>(n);
+    batch = (fit > static_cast<double>(min_batch)) ? static_cast<std::size_t>(std::min(fit, 1e9)) : min_batch;
+  }
+  return steps() - start;
+}
+
+bool Simulation::evolveGrid(std::span<double const> times)
+{
+  if (method_ != Integrator::DormandPrince) {
+    throw std::logic_error("an output grid requires the Dormand-Prince integrator.");
+  }
+  for (std::size_t i = 0; i < times.size(); ++i) {
+    double const t_prev = (i == 0) ? states_.ts().back() : times[i - 1];
+    if (!(times[i] > t_prev)) {
+      throw std::invalid_argument("output times must be increasing and after the current time.");
+    }
+  }
+
+  for (std::size_t done = 0; done < times.size();) {
+    std::size_t const n = std::min(chunk_size_, times.size() - done);
+    if (!evolve_grid(times.subspan(done, n))) {
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
 bool Simulation::isUnstable() const
 {
   return unstable_;
 }
+
+TrajectoryView::TrajectoryView(std::span<double const> ts, std::span<double const> xs, std::span<double const> ys,
+                               std::span<double const> Hs, std::array<double, 4> const& pars, double H0, std::size_t first_step)
+    : ts_{ts}
+    , xs_{xs}
+    , ys_{ys}
+    , Hs_{Hs}
+    , pars_{pars}
+    , H0_{H0}
+    , first_step_{first_step}
+{
+  if (ts.size() != xs.size() || ys.size() != xs.size() || Hs.size() != xs.size()) {
+    throw std::invalid_argument("trajectory columns must have the same length.");
+  }
+}
+
+TrajectoryView::TrajectoryView(Simulation const& simulation)
+    : TrajectoryView{simulation.ts(),
+                     simulation.xs(),
+                     simulation.ys(),
+                     simulation.Hs(),
+                     {simulation.getParameter(0), simulation.getParameter(1), simulation.getParameter(2), simulation.getParameter(3)},
+                     simulation.H0(),
+                     simulation.firstStep()}
+{}
+
+double TrajectoryView::getParameter(std::size_t i) const
+{
+  if (i > 3) {
+    throw std::out_of_range("parameter index out of range.");
+  }
+  return pars_[i];
+}
+
+double TrajectoryView::H0() const
+{
+  return H0_;
+}
+
+std::size_t TrajectoryView::steps() const
+{
+  return first_step_ + xs_.size();
+}
+
+std::size_t TrajectoryView::firstStep() const
+{
+  return first_step_;
+}
+
+std::span<double const> TrajectoryView::ts() const
+{
+  return ts_;
+}
+
+std::span<double const> TrajectoryView::xs() const
+{
+  return xs_;
+}
+
+std::span<double const> TrajectoryView::ys() const
+{
+  return ys_;
+}
+
+std::span<double const> TrajectoryView::Hs() const
+{
+  return Hs_;
+}
 } // namespace lotka_volterra
\ No newline at end of file
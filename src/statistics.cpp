@@ -0,0 +1,64 @@
+#include "statistics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace lotka_volterra {
+void RunningStatistics::check_count() const
+{
+  if (count_ == 0) {
+    throw std::logic_error("no state consumed yet.");
+  }
+}
+
+void RunningStatistics::add(Summary& summary, double value, std::size_t count) const
+{
+  summary.min = std::min(summary.min, value);
+  summary.max = std::max(summary.max, value);
+  summary.mean += (value - summary.mean) / static_cast<double>(count); // running mean, no stored history
+}
+
+RunningStatistics::RunningStatistics()
+{
+  double const inf = std::numeric_limits<double>::infinity();
+  x_               = {inf, -inf, 0.};
+  y_               = {inf, -inf, 0.};
+  H_               = {inf, -inf, 0.};
+}
+
+void RunningStatistics::consume(std::size_t, double, State const& state)
+{
+  ++count_;
+  add(x_, state.x, count_);
+  add(y_, state.y, count_);
+
+  if (std::isfinite(state.H)) { // extinction states have infinite energy
+    ++H_count_;
+    add(H_, state.H, H_count_);
+  }
+}
+
+std::size_t RunningStatistics::count() const
+{
+  return count_;
+}
+
+Summary RunningStatistics::x() const
+{
+  check_count();
+  return x_;
+}
+
+Summary RunningStatistics::y() const
+{
+  check_count();
+  return y_;
+}
+
+Summary RunningStatistics::H() const
+{
+  check_count();
+  return H_;
+}
+} // namespace lotka_volterra
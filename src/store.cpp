@@ -0,0 +1,194 @@
+#include "store.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <utility>
+#include <sys/mman.h>
+
+namespace lotka_volterra {
+namespace {
+constexpr std::size_t page_states = 4096 / sizeof(double); // capacities are whole pages
+} // namespace
+
+// the first size() states of column i: the length is loaded first, and the range that holds them was published before
+std::span<double const> StateStore::column(std::size_t i) const
+{
+  std::size_t const n      = size();
+  Range const* const range = range_.load(std::memory_order_acquire);
+  return (range != nullptr) ? std::span<double const>{range->columns[i], n} : std::span<double const>{};
+}
+
+// switches to a new range of at least `states` states, with a copy of the states so far; the old range stays mapped,
+// unchanged, for the spans and the readers that still point into it
+void StateStore::grow(std::size_t states)
+{
+  if (states > std::numeric_limits<std::size_t>::max() / (8 * sizeof(double))) {
+    throw std::bad_alloc();
+  }
+  std::size_t const capacity = (states + page_states - 1) / page_states * page_states;
+
+  ranges_.reserve(ranges_.size() + 1); // nothing can fail once the range is mapped
+  void* const base = mmap(nullptr, 4 * capacity * sizeof(double), PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  auto range = std::make_unique<Range>();
+  for (std::size_t i = 0; i < 4; ++i) {
+    range->columns[i] = static_cast<double*>(base) + i * capacity;
+  }
+  range->capacity = capacity;
+
+  std::size_t const n = size_.load(std::memory_order_relaxed); // the only writer
+  if (n > 0) {
+    Range const* const old = range_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < 4; ++i) {
+      std::memcpy(range->columns[i], old->columns[i], n * sizeof(double));
+    }
+  }
+  ranges_.push_back(std::move(range));
+  range_.store(ranges_.back().get(), std::memory_order_release); // the copied states are written before
+}
+
+void StateStore::release()
+{
+  for (std::unique_ptr<Range> const& range : ranges_) {
+    munmap(range->columns[0], 4 * range->capacity * sizeof(double));
+  }
+  ranges_.clear();
+}
+
+StateStore::StateStore(StateStore const& other)
+{
+  std::size_t const n = other.size();
+  if (n == 0) {
+    return;
+  }
+  grow(std::max(n, range_states));
+  Range const* const range                      = ranges_.back().get();
+  std::array<std::span<double const>, 4> const from{other.ts(), other.xs(), other.ys(), other.Hs()};
+  for (std::size_t i = 0; i < 4; ++i) {
+    std::memcpy(range->columns[i], from[i].data(), n * sizeof(double));
+  }
+  size_.store(n, std::memory_order_release);
+}
+
+StateStore::StateStore(StateStore&& other) noexcept
+    : ranges_{std::move(other.ranges_)}
+    , range_{other.range_.exchange(nullptr, std::memory_order_acq_rel)}
+    , size_{other.size_.exchange(0, std::memory_order_acq_rel)}
+{
+  other.ranges_.clear();
+}
+
+StateStore& StateStore::operator=(StateStore other) noexcept
+{
+  std::swap(ranges_, other.ranges_);
+  other.range_.store(range_.exchange(other.range_.load(std::memory_order_acquire), std::memory_order_acq_rel),
+                     std::memory_order_release);
+  other.size_.store(size_.exchange(other.size_.load(std::memory_order_acquire), std::memory_order_acq_rel),
+                    std::memory_order_release);
+  return *this;
+}
+
+StateStore::~StateStore()
+{
+  release();
+}
+
+std::size_t StateStore::size() const
+{
+  return size_.load(std::memory_order_acquire);
+}
+
+// states the range in use holds before the store grows
+std::size_t StateStore::capacity() const
+{
+  Range const* const range = range_.load(std::memory_order_acquire);
+  return (range != nullptr) ? range->capacity : 0;
+}
+
+// memory of the stored states, which grows with the run (the reserved range only takes the pages written)
+std::size_t StateStore::bytes() const
+{
+  return 4 * size() * sizeof(double);
+}
+
+// room for `states` states, so that the store does not grow until then
+void StateStore::reserve(std::size_t states)
+{
+  if (states > capacity()) {
+    grow(states);
+  }
+}
+
+std::span<double const> StateStore::ts() const
+{
+  return column(0);
+}
+
+std::span<double const> StateStore::xs() const
+{
+  return column(1);
+}
+
+std::span<double const> StateStore::ys() const
+{
+  return column(2);
+}
+
+std::span<double const> StateStore::Hs() const
+{
+  return column(3);
+}
+
+void StateStore::append(std::span<double const> t, std::span<double const> x, std::span<double const> y,
+                        std::span<double const> H)
+{
+  if (t.empty()) {
+    return;
+  }
+  std::size_t const n        = size_.load(std::memory_order_relaxed); // the only writer
+  std::size_t const size     = n + t.size();
+  std::size_t const capacity = this->capacity();
+  if (size > capacity) {
+    grow(std::max(size, (capacity == 0) ? range_states : 2 * capacity)); // doubling: amortized O(1) copies per state
+  }
+  Range const* const range = range_.load(std::memory_order_relaxed);
+  std::array<std::span<double const>, 4> const columns{t, x, y, H};
+  for (std::size_t i = 0; i < 4; ++i) {
+    std::memcpy(range->columns[i] + n, columns[i].data(), t.size() * sizeof(double));
+  }
+  size_.store(size, std::memory_order_release); // the states are written before they are published
+}
+
+void StateStore::push_back(double t, double x, double y, double H)
+{
+  std::size_t const n = size_.load(std::memory_order_relaxed);
+  if (n == capacity()) {
+    grow((n == 0) ? range_states : 2 * n);
+  }
+  Range const* const range = range_.load(std::memory_order_relaxed);
+  range->columns[0][n]     = t;
+  range->columns[1][n]     = x;
+  range->columns[2][n]     = y;
+  range->columns[3][n]     = H;
+  size_.store(n + 1, std::memory_order_release);
+}
+
+// drops the n oldest states, moving the others to the front of the range in use; the ranges are kept
+void StateStore::eraseFront(std::size_t n)
+{
+  std::size_t const size = size_.load(std::memory_order_relaxed);
+  n                      = std::min(n, size);
+  if (n == 0) {
+    return;
+  }
+  Range const* const range = range_.load(std::memory_order_relaxed);
+  for (std::size_t i = 0; i < 4; ++i) {
+    std::memmove(range->columns[i], range->columns[i] + n, (size - n) * sizeof(double));
+  }
+  size_.store(size - n, std::memory_order_release);
+}
+} // namespace lotka_volterra
@@ -0,0 +1,139 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+namespace lotka_volterra {
+namespace {
+struct ThreadBuffer
+{
+  std::unique_ptr<TraceEvent[]> events{std::make_unique_for_overwrite<TraceEvent[]>(Trace::max_events)}; // pages touched as filled
+  std::atomic<std::size_t> size{0};       // published with a release store once the event is written
+  std::atomic<std::size_t> generation{0}; // trace the events belong to
+  std::uint32_t thread = 0;
+};
+
+// buffers of every thread that recorded, never freed: the events of a thread outlive it, and the buffer of a thread
+// that exited is taken over by the next new one instead of allocating another
+struct Registry
+{
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::vector<ThreadBuffer*> free;
+  std::atomic<std::size_t> generation{0};
+  std::atomic<std::size_t> dropped{0};
+  std::atomic<Trace::Clock::rep> epoch{0};
+};
+
+Registry& registry()
+{
+  static Registry instance;
+  return instance;
+}
+
+struct BufferHolder
+{
+  ThreadBuffer* buffer = nullptr;
+
+  ~BufferHolder()
+  {
+    if (buffer != nullptr) {
+      Registry& r = registry();
+      std::lock_guard lock{r.mutex};
+      r.free.push_back(buffer);
+    }
+  }
+};
+
+ThreadBuffer& this_thread_buffer()
+{
+  thread_local BufferHolder holder;
+  if (holder.buffer == nullptr) { // first event of the thread
+    Registry& r = registry();
+    std::lock_guard lock{r.mutex};
+    if (r.free.empty()) {
+      r.buffers.push_back(std::make_unique<ThreadBuffer>());
+      r.buffers.back()->thread = static_cast<std::uint32_t>(r.buffers.size() - 1);
+      holder.buffer            = r.buffers.back().get();
+    } else {
+      holder.buffer = r.free.back();
+      r.free.pop_back();
+    }
+  }
+  return *holder.buffer;
+}
+} // namespace
+
+void Trace::start()
+{
+  Registry& r = registry();
+  r.epoch.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+  r.dropped.store(0, std::memory_order_relaxed);
+  r.generation.fetch_add(1, std::memory_order_release); // every buffer starts over at its next event
+  enabled_.store(true, std::memory_order_release);
+}
+
+void Trace::stop()
+{
+  enabled_.store(false, std::memory_order_release);
+}
+
+std::int64_t Trace::now()
+{
+  auto const ticks = Clock::now().time_since_epoch().count() - registry().epoch.load(std::memory_order_relaxed);
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::duration{ticks}).count();
+}
+
+void Trace::record(TraceEvent const& event)
+{
+  Registry& r                  = registry();
+  ThreadBuffer& buffer         = this_thread_buffer();
+  std::size_t const generation = r.generation.load(std::memory_order_acquire);
+  if (buffer.generation.load(std::memory_order_relaxed) != generation) { // events of an older trace
+    buffer.size.store(0, std::memory_order_relaxed);
+    buffer.generation.store(generation, std::memory_order_relaxed);
+  }
+
+  std::size_t const n = buffer.size.load(std::memory_order_relaxed); // the only writer
+  if (n == max_events) {
+    r.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer.events[n]        = event;
+  buffer.events[n].thread = buffer.thread;
+  buffer.size.store(n + 1, std::memory_order_release);
+}
+
+void Trace::counter(char const* name, double value)
+{
+  if (enabled()) {
+    record({name, now(), 0, value, 0, 'C'});
+  }
+}
+
+// the events of the current trace, by thread and then by start
+std::vector<TraceEvent> Trace::events()
+{
+  Registry& r = registry();
+  std::lock_guard lock{r.mutex};
+  std::size_t const generation = r.generation.load(std::memory_order_acquire);
+
+  std::vector<TraceEvent> events;
+  for (auto const& buffer : r.buffers) {
+    if (buffer->generation.load(std::memory_order_relaxed) == generation) {
+      std::size_t const n = buffer->size.load(std::memory_order_acquire);
+      events.insert(events.end(), buffer->events.get(), buffer->events.get() + n);
+    }
+  }
+  std::stable_sort(events.begin(), events.end(), [](TraceEvent const& a, TraceEvent const& b) {
+    return a.thread != b.thread ? a.thread < b.thread : a.start < b.start;
+  });
+  return events;
+}
+
+// events dropped by full buffers since start()
+std::size_t Trace::dropped()
+{
+  return registry().dropped.load(std::memory_order_relaxed);
+}
+} // namespace lotka_volterra
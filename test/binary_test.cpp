@@ -0,0 +1,231 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "binary.hpp"
+#include "output.hpp"
+#include "renderer.hpp"
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+
+namespace {
+std::string read_file(std::string const& filename)
+{
+  std::ifstream file{filename, std::ios::binary};
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+void check_columns(io::MappedTrajectory const& mapped, lotka_volterra::Simulation const& sim)
+{
+  REQUIRE(mapped.xs().size() == sim.xs().size());
+  for (std::size_t i = 0; i < sim.xs().size(); ++i) {
+    CHECK(mapped.ts()[i] == sim.ts()[i]);
+    CHECK(mapped.xs()[i] == sim.xs()[i]);
+    CHECK(mapped.ys()[i] == sim.ys()[i]);
+    CHECK(mapped.Hs()[i] == sim.Hs()[i]);
+  }
+}
+} // namespace
+
+TEST_CASE("Binary round trip preserves columns and header")
+{
+  lotka_volterra::Simulation sim{0.01, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7, lotka_volterra::Integrator::RK4};
+  sim.evolveSteps(1000);
+  io::outputBinary(sim, "test.lvt");
+
+  io::MappedTrajectory const mapped{"test.lvt"};
+  check_columns(mapped, sim);
+  CHECK(mapped.version() == io::binary_version);
+  CHECK(mapped.method() == lotka_volterra::Integrator::RK4);
+  CHECK(mapped.dt() == sim.dt());
+  for (std::size_t i = 0; i < 4; ++i) {
+    CHECK(mapped.getParameter(i) == sim.getParameter(i));
+  }
+  CHECK_THROWS(mapped.getParameter(4));
+  CHECK(mapped.H0() == sim.H0());
+  CHECK(mapped.maxRelDrift() == sim.maxRelDrift());
+  CHECK(!mapped.isUnstable());
+  CHECK(mapped.steps() == sim.steps());
+  CHECK(mapped.firstStep() == 0);
+
+  std::filesystem::remove("test.lvt");
+}
+
+TEST_CASE("Binary file has the documented layout")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1., 1.};
+  sim.evolveSteps(9);
+  io::outputBinary(sim, "test.lvt");
+
+  std::string const bytes = read_file("test.lvt");
+  REQUIRE(bytes.size() == sizeof(io::BinaryHeader) + 10 * 4 * sizeof(double));
+  CHECK(bytes.compare(0, 8, std::string("LVTRAJ\0\0", 8)) == 0);
+
+  io::BinaryHeader header;
+  std::memcpy(&header, bytes.data(), sizeof header);
+  CHECK(header.version == 1);
+  CHECK(header.header_size == 128);
+  CHECK(header.rows == 10);
+  CHECK(header.column_count == 4);
+
+  double x5;
+  std::memcpy(&x5, bytes.data() + 128 + (10 + 5) * sizeof(double), sizeof x5); // x column, row 5
+  CHECK(x5 == sim.xs()[5]);
+
+  std::filesystem::remove("test.lvt");
+}
+
+TEST_CASE("Binary round trip preserves a bounded history and the unstable flag")
+{
+  lotka_volterra::Simulation bounded{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  bounded.setHistory(64);
+  bounded.evolveSteps(1000);
+  io::outputBinary(bounded, "test.lvt");
+  {
+    io::MappedTrajectory const mapped{"test.lvt"};
+    check_columns(mapped, bounded);
+    CHECK(mapped.firstStep() == bounded.firstStep());
+    CHECK(mapped.firstStep() > 0);
+    CHECK(mapped.steps() == bounded.steps());
+  }
+
+  lotka_volterra::Simulation unstable{0.01, 50., 1., 1., 50., 1., 1.};
+  unstable.evolveSteps(10000);
+  REQUIRE(unstable.isUnstable());
+  io::outputBinary(unstable, "test.lvt");
+  {
+    io::MappedTrajectory const mapped{"test.lvt"};
+    CHECK(mapped.isUnstable());
+    CHECK(mapped.maxRelDrift() == unstable.maxRelDrift());
+  }
+
+  std::filesystem::remove("test.lvt");
+}
+
+TEST_CASE("Binary reader rejects invalid files")
+{
+  CHECK_THROWS(io::MappedTrajectory{"missing.lvt"});
+
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1., 1.};
+  sim.evolveSteps(100);
+
+  io::outputCSV(sim, "test.csv");
+  CHECK_THROWS(io::MappedTrajectory{"test.csv"});
+  std::filesystem::remove("test.csv");
+
+  io::outputBinary(sim, "test.lvt");
+  std::filesystem::resize_file("test.lvt", std::filesystem::file_size("test.lvt") - 8);
+  CHECK_THROWS(io::MappedTrajectory{"test.lvt"});
+
+  io::outputBinary(sim, "test.lvt");
+  {
+    std::fstream file{"test.lvt", std::ios::binary | std::ios::in | std::ios::out};
+    std::uint32_t const version = 2;
+    file.seekp(8);
+    file.write(reinterpret_cast<char const*>(&version), sizeof version);
+  }
+  CHECK_THROWS(io::MappedTrajectory{"test.lvt"});
+
+  std::filesystem::remove("test.lvt");
+}
+
+TEST_CASE("Mapped trajectory moves, draws and exports like the simulation")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  sim.evolveSteps(500);
+  io::outputBinary(sim, "test.lvt");
+
+  io::MappedTrajectory first{"test.lvt"};
+  io::MappedTrajectory mapped{std::move(first)};
+  check_columns(mapped, sim);
+
+  lotka_volterra::Renderer r{800};
+  sf::RenderWindow window{sf::VideoMode(800, 800), "test", sf::Style::None};
+  CHECK_NOTHROW(r.draw(window, mapped.view(), 250));
+  CHECK_NOTHROW(r.draw(window, mapped.view()));
+
+  io::outputCSV(sim, "test.csv");
+  io::outputCSV(mapped.view(), "mapped.csv");
+  CHECK(read_file("test.csv") == read_file("mapped.csv"));
+
+  std::filesystem::remove("test.csv");
+  std::filesystem::remove("mapped.csv");
+  std::filesystem::remove("test.lvt");
+}
+
+TEST_CASE("Compressed binary round trip keeps every state of a compressed history")
+{
+  lotka_volterra::Simulation sim{0.0001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7};
+  sim.setCompressedHistory(1000);
+  sim.evolveSteps(20000);
+  io::outputCompressed(sim, "test.lvz");
+
+  io::CompressedRun const run = io::inputCompressed("test.lvz");
+  CHECK((run.header.flags & io::binary_compressed) != 0);
+  CHECK(run.header.first_step == 0);
+  CHECK(run.header.rows == sim.steps());
+  CHECK(run.header.dt == sim.dt());
+  CHECK(run.trajectory.steps() == sim.steps());
+  for (std::size_t i = 0; i < sim.steps(); i += 13) {
+    lotka_volterra::State const a = sim.stateAt(i);
+    lotka_volterra::State const b = run.trajectory.stateAt(i);
+    CHECK(a.x == b.x);
+    CHECK(a.y == b.y);
+    CHECK(a.H == b.H);
+    CHECK(sim.timeAt(i) == run.trajectory.timeAt(i));
+  }
+  CHECK(std::filesystem::file_size("test.lvz") < 20001 * 4 * sizeof(double) / 3);
+
+  CHECK_THROWS(io::MappedTrajectory{"test.lvz"});
+  io::outputBinary(sim, "test.lvt");
+  CHECK_THROWS(io::inputCompressed("test.lvt"));
+
+  std::filesystem::resize_file("test.lvz", std::filesystem::file_size("test.lvz") - 100);
+  CHECK_THROWS(io::inputCompressed("test.lvz"));
+
+  std::filesystem::remove("test.lvz");
+  std::filesystem::remove("test.lvt");
+}
+
+TEST_CASE("Lossy binary round trip keeps every state within its bound")
+{
+  using lotka_volterra::ErrorBound;
+  lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7, lotka_volterra::Integrator::RK4};
+  sim.setCompressedHistory(1000);
+  sim.evolveSteps(20000);
+  std::array<ErrorBound, 4> const bounds{ErrorBound::absolute(1e-12), ErrorBound::absolute(1e-5), ErrorBound::absolute(1e-5),
+                                         ErrorBound::relative(1e-8)};
+  io::outputLossy(sim, bounds, "test.lvl");
+
+  io::LossyRun const run = io::inputLossy("test.lvl");
+  CHECK((run.header.flags & io::binary_lossy) != 0);
+  CHECK(run.header.rows == sim.steps());
+  REQUIRE(run.trajectory.steps() == sim.steps());
+  for (std::size_t c = 0; c < 4; ++c) {
+    CHECK(run.trajectory.column(c).codec().bound().mode == bounds[c].mode);
+    CHECK(run.trajectory.column(c).codec().bound().value == bounds[c].value);
+  }
+  for (std::size_t i = 0; i < sim.steps(); i += 7) {
+    lotka_volterra::State const a = sim.stateAt(i);
+    lotka_volterra::State const b = run.trajectory.stateAt(i);
+    CHECK(std::abs(sim.timeAt(i) - run.trajectory.timeAt(i)) <= 1e-12);
+    CHECK(std::abs(a.x - b.x) <= 1e-5);
+    CHECK(std::abs(a.y - b.y) <= 1e-5);
+    CHECK(std::abs(a.H - b.H) <= 1e-8 * std::abs(a.H));
+  }
+  io::outputCompressed(sim, "test.lvz");
+  CHECK(std::filesystem::file_size("test.lvl") < std::filesystem::file_size("test.lvz") / 2);
+
+  CHECK_THROWS(io::inputCompressed("test.lvl"));
+  CHECK_THROWS(io::inputLossy("test.lvz"));
+  CHECK_THROWS(io::MappedTrajectory{"test.lvl"});
+  CHECK_THROWS(io::outputLossy(sim, {ErrorBound::absolute(0.), bounds[1], bounds[2], bounds[3]}, "test.lvl"));
+
+  std::filesystem::resize_file("test.lvl", std::filesystem::file_size("test.lvl") - 100);
+  CHECK_THROWS(io::inputLossy("test.lvl"));
+
+  std::filesystem::remove("test.lvl");
+  std::filesystem::remove("test.lvz");
+}
@@ -0,0 +1,226 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "simulation.hpp"
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace {
+bool same_bits(double a, double b)
+{
+  return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b);
+}
+} // namespace
+
+TEST_CASE("Compressed column round trips any double bit for bit")
+{
+  std::mt19937_64 rng{42};
+  std::vector<double> values{0., -0., 1., -1., std::numeric_limits<double>::infinity(),
+                             -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN(),
+                             std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::max(),
+                             std::numeric_limits<double>::lowest()};
+  for (std::size_t i = 0; i < 5000; ++i) {
+    values.push_back(std::bit_cast<double>(rng())); // arbitrary bit patterns, NaNs included
+  }
+  for (std::size_t i = 0; i < 5000; ++i) {
+    values.push_back(std::sin(0.001 * static_cast<double>(i)));
+  }
+
+  lotka_volterra::CompressedColumn column;
+  for (std::size_t i = 0; i < 3000; ++i) {
+    column.push_back(values[i]);
+  }
+  column.append(std::span{values}.subspan(3000));
+  REQUIRE(column.size() == values.size());
+
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    CHECK(same_bits(column.at(i), values[i]));
+  }
+  CHECK_THROWS(column.at(values.size()));
+}
+
+TEST_CASE("Compressed column decodes any range across blocks and partial blocks")
+{
+  lotka_volterra::CompressedColumn column;
+  std::vector<double> values;
+  for (std::size_t i = 0; i < 5000; ++i) {
+    values.push_back(std::exp(-1e-3 * static_cast<double>(i)));
+    column.push_back(values.back());
+    if (i == 1500 || i == 1501) {
+      column.flush(); // partial blocks, as written to disk
+    }
+  }
+  CHECK(column.index().size() == 6); // 0, 1024, 1501, 1502, 2526, 3550, the last 426 values still open
+
+  for (auto [first, last] : {std::pair{0, 5000}, {0, 0}, {1000, 1030}, {1020, 3100}, {1501, 1502}, {4090, 5000}, {4999, 5000}}) {
+    std::vector<double> out(static_cast<std::size_t>(last - first));
+    column.decode(static_cast<std::size_t>(first), static_cast<std::size_t>(last), out);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+      CHECK(same_bits(out[i], values[static_cast<std::size_t>(first) + i]));
+    }
+  }
+  std::vector<double> out(10);
+  CHECK_THROWS(column.decode(4995, 5001, out));
+  CHECK_THROWS(column.decode(0, 20, out));
+}
+
+TEST_CASE("Compressed column rebuilt from its bytes and index decodes the same values")
+{
+  lotka_volterra::CompressedColumn column;
+  for (std::size_t i = 0; i < 3000; ++i) {
+    column.push_back(static_cast<double>(i) * 0.01);
+  }
+  column.flush();
+
+  std::vector<std::uint8_t> const bytes(column.bytes().begin(), column.bytes().end());
+  std::vector<lotka_volterra::CompressedColumn::Block> const index(column.index().begin(), column.index().end());
+  lotka_volterra::CompressedColumn const copy{bytes, index, 3000};
+  for (std::size_t i = 0; i < 3000; i += 7) {
+    CHECK(same_bits(copy.at(i), column.at(i)));
+  }
+
+  CHECK_THROWS(lotka_volterra::CompressedColumn{bytes, index, 5000});
+  CHECK_THROWS(lotka_volterra::CompressedColumn{bytes, {}, 3000});
+  std::vector<std::uint8_t> corrupted = bytes;
+  corrupted[0]                        = 0; // order byte of the first block
+  CHECK_THROWS(lotka_volterra::CompressedColumn{corrupted, index, 3000}.at(5));
+}
+
+TEST_CASE("Compressed history keeps every evicted state without losing any bits")
+{
+  lotka_volterra::Simulation full{0.0001, 1., 1., 1., 1., 1.5, 1.5};
+  lotka_volterra::Simulation compressed{0.0001, 1., 1., 1., 1., 1.5, 1.5};
+  compressed.setCompressedHistory(4096);
+  full.evolveSteps(100000);
+  compressed.evolveSteps(100000);
+
+  CHECK(compressed.isCompressed());
+  CHECK(compressed.xs().size() <= 2 * 4096);
+  CHECK(compressed.archive().firstStep() == 0);
+  CHECK(compressed.archive().steps() == compressed.firstStep());
+  for (std::size_t i = 0; i < full.steps(); i += 97) {
+    lotka_volterra::State const a = full.stateAt(i);
+    lotka_volterra::State const b = compressed.stateAt(i);
+    CHECK(same_bits(a.x, b.x));
+    CHECK(same_bits(a.y, b.y));
+    CHECK(same_bits(a.H, b.H));
+    CHECK(same_bits(full.timeAt(i), compressed.timeAt(i)));
+  }
+  CHECK_THROWS(compressed.stateAt(full.steps()));
+
+  // a smooth Euler trajectory needs about 2 bytes per value instead of 8
+  std::size_t const archived = compressed.archive().steps();
+  CHECK(static_cast<double>(compressed.archive().compressedBytes()) < 0.25 * static_cast<double>(archived * 4 * sizeof(double)));
+
+  CHECK_THROWS(compressed.setCompressedHistory(0));
+}
+
+TEST_CASE("Compressed history started late archives from the current first step")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5, lotka_volterra::Integrator::RK4};
+  sim.setHistory(100);
+  sim.evolveSteps(1000);
+  std::size_t const first = sim.firstStep();
+  sim.setCompressedHistory(100);
+  sim.evolveSteps(1000);
+
+  CHECK(sim.archive().firstStep() == first);
+  CHECK_NOTHROW(sim.stateAt(first));
+  CHECK_THROWS(sim.stateAt(first - 1));
+}
+
+TEST_CASE("Lossy column keeps every value within its absolute bound")
+{
+  std::mt19937_64 rng{7};
+  std::normal_distribution<double> noise{0., 1e-3};
+  std::vector<double> values{std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(), 1e300, -0.};
+  for (std::size_t i = 0; i < 6000; ++i) {
+    values.push_back(std::sin(0.002 * static_cast<double>(i)) + ((i % 1000 < 200) ? noise(rng) : 0.));
+  }
+  values[3000] = 1e6; // outlier, stored exactly
+  values[3001] = -std::numeric_limits<double>::infinity();
+
+  for (double const bound : {1e-2, 1e-6, 1e-12}) {
+    lotka_volterra::LossyColumn column{lotka_volterra::QuantizedCodec{lotka_volterra::ErrorBound::absolute(bound)}};
+    column.append(std::span{values}.first(1500));
+    column.flush(); // partial block
+    column.append(std::span{values}.subspan(1500));
+    REQUIRE(column.size() == values.size());
+
+    std::vector<double> out(values.size());
+    column.decode(0, values.size(), out);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      if (!std::isfinite(values[i])) {
+        CHECK(same_bits(out[i], values[i]));
+      } else {
+        CHECK(std::abs(out[i] - values[i]) <= bound);
+      }
+    }
+    CHECK(same_bits(column.at(4321), out[4321]));
+
+    column.flush();
+    std::vector<std::uint8_t> const bytes(column.bytes().begin(), column.bytes().end());
+    std::vector<lotka_volterra::LossyColumn::Block> const index(column.index().begin(), column.index().end());
+    lotka_volterra::LossyColumn const copy{bytes, index, values.size(), column.codec()};
+    for (std::size_t i = 0; i < values.size(); i += 11) {
+      CHECK(same_bits(copy.at(i), column.at(i)));
+      CHECK((!std::isfinite(values[i]) || std::abs(copy.at(i) - values[i]) <= bound));
+    }
+    std::vector<std::uint8_t> corrupted = bytes;
+    corrupted[1]                        = 60; // code width of the first block
+    CHECK_THROWS(lotka_volterra::LossyColumn{corrupted, index, values.size(), column.codec()}.at(5));
+  }
+
+  // a loose bound on a smooth column costs a few bits per value
+  lotka_volterra::LossyColumn smooth{lotka_volterra::QuantizedCodec{lotka_volterra::ErrorBound::absolute(1e-6)}};
+  smooth.append(std::span{values}.subspan(1204, 800));
+  smooth.flush();
+  CHECK(smooth.compressedBytes() < 800 * sizeof(double) / 8);
+}
+
+TEST_CASE("Lossy column keeps every value within its relative bound")
+{
+  std::vector<double> values;
+  for (std::size_t i = 0; i < 5000; ++i) {
+    values.push_back(std::exp(-0.01 * static_cast<double>(i)) * std::cos(0.05 * static_cast<double>(i)));
+  }
+  values[100] = 0.;
+
+  lotka_volterra::LossyColumn column{lotka_volterra::QuantizedCodec{lotka_volterra::ErrorBound::relative(1e-4)}};
+  column.append(values);
+  std::vector<double> out(values.size());
+  column.decode(0, values.size(), out);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    CHECK(std::abs(out[i] - values[i]) <= 1e-4 * std::abs(values[i])); // down to 1e-22, and 0 exactly
+  }
+
+  CHECK_THROWS(lotka_volterra::QuantizedCodec{lotka_volterra::ErrorBound::relative(0.)});
+  CHECK_THROWS(lotka_volterra::QuantizedCodec{lotka_volterra::ErrorBound::absolute(-1.)});
+  CHECK_THROWS(lotka_volterra::QuantizedCodec{lotka_volterra::ErrorBound::absolute(std::numeric_limits<double>::quiet_NaN())});
+}
+
+TEST_CASE("Lossy trajectory fed as a sink codes every state within the bounds")
+{
+  using lotka_volterra::ErrorBound;
+  using lotka_volterra::QuantizedCodec;
+  lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7, lotka_volterra::Integrator::RK4};
+  sim.evolveSteps(100);
+  lotka_volterra::LossyTrajectory trajectory{0, {QuantizedCodec{ErrorBound::absolute(1e-12)}, QuantizedCodec{ErrorBound::absolute(1e-6)},
+                                                 QuantizedCodec{ErrorBound::absolute(1e-6)}, QuantizedCodec{ErrorBound::relative(1e-9)}}};
+  sim.addSink(trajectory);
+  sim.evolveSteps(10000);
+
+  REQUIRE(trajectory.steps() == sim.steps());
+  for (std::size_t i = 0; i < sim.steps(); ++i) {
+    lotka_volterra::State const state = trajectory.stateAt(i);
+    CHECK(std::abs(trajectory.timeAt(i) - sim.ts()[i]) <= 1e-12);
+    CHECK(std::abs(state.x - sim.xs()[i]) <= 1e-6);
+    CHECK(std::abs(state.y - sim.ys()[i]) <= 1e-6);
+    CHECK(std::abs(state.H - sim.Hs()[i]) <= 1e-9 * std::abs(sim.Hs()[i]));
+  }
+  CHECK(trajectory.compressedBytes() < sim.steps() * 4 * sizeof(double) / 8);
+
+  CHECK_THROWS_AS(trajectory.consume(5, 0., {1., 1., 1.}), std::logic_error);
+}
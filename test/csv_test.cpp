@@ -0,0 +1,195 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "csv.hpp"
+#include "output.hpp"
+#include "renderer.hpp"
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+std::string read_file(std::string const& filename)
+{
+  std::ifstream file{filename, std::ios::binary};
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+void write_file(std::string const& filename, std::string const& content)
+{
+  std::ofstream file{filename, std::ios::binary};
+  file << content;
+}
+
+// value read back from a column written with `precision` significant digits, as std::from_chars reads it
+double reread(double value, int precision)
+{
+  char text[32];
+  char* const end = std::to_chars(text, text + sizeof text, value, std::chars_format::general, precision).ptr;
+  double result   = 0.;
+  std::from_chars(text, end, result);
+  return result;
+}
+} // namespace
+
+TEST_CASE("CSV import reads back the exported trajectory")
+{
+  lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7, lotka_volterra::Integrator::RK4};
+  sim.evolveSteps(100000); // about 7 MB at full precision: several chunks with 4 threads
+
+  io::CSVOptions options;
+  options.precision = 0;
+  io::outputCSV(sim, "test.csv", options);
+  for (std::size_t threads : {1u, 3u, 4u}) {
+    io::CSVTrajectory const csv{"test.csv", threads};
+    REQUIRE(csv.steps() == sim.steps());
+    bool exact = true;
+    for (std::size_t i = 0; i < sim.steps(); ++i) {
+      exact = exact && csv.ts()[i] == sim.ts()[i] && csv.xs()[i] == sim.xs()[i] && csv.ys()[i] == sim.ys()[i] && csv.Hs()[i] == sim.Hs()[i];
+    }
+    CHECK(exact);
+  }
+
+  // default precision: the fast path gives exactly the value std::from_chars gives
+  options.precision = 6;
+  options.columns   = {io::Column::H, io::Column::y, io::Column::t, io::Column::x};
+  io::outputCSV(sim, "test.csv", options);
+  io::CSVTrajectory const csv{"test.csv", 4};
+  REQUIRE(csv.steps() == sim.steps());
+  bool same = true;
+  for (std::size_t i = 0; i < sim.steps(); ++i) {
+    same = same && csv.ts()[i] == reread(sim.ts()[i], 6) && csv.xs()[i] == reread(sim.xs()[i], 6)
+        && csv.ys()[i] == reread(sim.ys()[i], 6) && csv.Hs()[i] == reread(sim.Hs()[i], 6);
+  }
+  CHECK(same);
+
+  std::filesystem::remove("test.csv");
+}
+
+TEST_CASE("CSV import parses every number form")
+{
+  write_file("test.csv", "x,t,H,y\r\n"
+                         "0,1,2,3\r\n"
+                         "-0,1e-05,-2.5E+3,1234567890123456789\r\n"
+                         "5e-324,1.7976931348623157e+308,inf,-inf\r\n"
+                         "nan,0.30000000000000004,123456.789e-3,.5\r\n"
+                         "9007199254740993,1e23,0.000001,1e-22");
+  io::CSVTrajectory const csv{"test.csv"};
+  REQUIRE(csv.steps() == 5);
+  CHECK(csv.xs()[0] == 0.);
+  CHECK(csv.ts()[0] == 1.);
+  CHECK(csv.Hs()[0] == 2.);
+  CHECK(csv.ys()[0] == 3.);
+  CHECK(std::signbit(csv.xs()[1]));
+  CHECK(csv.ts()[1] == 1e-05);
+  CHECK(csv.Hs()[1] == -2.5e3);
+  CHECK(csv.ys()[1] == 1234567890123456789.);
+  CHECK(csv.xs()[2] == 5e-324);
+  CHECK(csv.ts()[2] == 1.7976931348623157e+308);
+  CHECK(csv.Hs()[2] == HUGE_VAL);
+  CHECK(csv.ys()[2] == -HUGE_VAL);
+  CHECK(std::isnan(csv.xs()[3]));
+  CHECK(csv.ts()[3] == 0.30000000000000004);
+  CHECK(csv.Hs()[3] == 123456.789e-3);
+  CHECK(csv.ys()[3] == 0.5);
+  CHECK(csv.xs()[4] == 9007199254740993.); // above 2^53: rounded by std::from_chars, not by the fast path
+  CHECK(csv.ts()[4] == 1e23);
+  CHECK(csv.Hs()[4] == 0.000001);
+  CHECK(csv.ys()[4] == 1e-22);
+
+  std::filesystem::remove("test.csv");
+}
+
+TEST_CASE("CSV import reads a subset of the columns and skips empty lines at the end")
+{
+  lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7};
+  sim.evolveSteps(100);
+  io::CSVOptions options;
+  options.columns   = {io::Column::H, io::Column::x};
+  options.precision = 0;
+  io::outputCSV(sim, "test.csv", options);
+
+  io::CSVTrajectory const csv{"test.csv"};
+  CHECK(csv.steps() == 101);
+  CHECK(csv.hasColumn(io::Column::x));
+  CHECK(csv.hasColumn(io::Column::H));
+  CHECK(!csv.hasColumn(io::Column::t));
+  CHECK(!csv.hasColumn(io::Column::y));
+  CHECK(csv.ts().empty());
+  CHECK(csv.ys().empty());
+  for (std::size_t i = 0; i < csv.steps(); ++i) {
+    CHECK(csv.xs()[i] == sim.xs()[i]);
+    CHECK(csv.Hs()[i] == sim.Hs()[i]);
+  }
+
+  for (char const* ending : {"\n\n", "\r\n\r\n", "\n\n\n", ""}) {
+    write_file("test.csv", std::string{"t,x,y,H\n0,1,1,1\n1,2,2,2"} + ending);
+    io::CSVTrajectory const blank{"test.csv"};
+    CHECK(blank.steps() == 2);
+    CHECK(blank.Hs()[1] == 2.);
+  }
+
+  std::filesystem::remove("test.csv");
+}
+
+TEST_CASE("CSV import rejects invalid files")
+{
+  CHECK_THROWS_AS(io::CSVTrajectory{"missing.csv"}, std::runtime_error);
+
+  write_file("test.csv", "");
+  CHECK_THROWS_WITH_AS(io::CSVTrajectory{"test.csv"}, "empty csv file.", std::runtime_error);
+  write_file("test.csv", "t,x,y,H\n");
+  CHECK_THROWS_WITH_AS(io::CSVTrajectory{"test.csv"}, "csv file has no rows.", std::runtime_error);
+  write_file("test.csv", "t,x,y,H,t\n0,1,1,1,0\n");
+  CHECK_THROWS_WITH_AS(io::CSVTrajectory{"test.csv"}, "csv header names the column t twice.", std::runtime_error);
+  write_file("test.csv", "t,x,x,H\n0,1,1,1\n");
+  CHECK_THROWS_WITH_AS(io::CSVTrajectory{"test.csv"}, "csv header names the column x twice.", std::runtime_error);
+  write_file("test.csv", "t,x,y,E\n0,1,1,1\n");
+  CHECK_THROWS_WITH_AS(io::CSVTrajectory{"test.csv"}, "csv header names an unknown column \"E\": the columns are t, x, y, H.",
+                       std::runtime_error);
+  write_file("test.csv", "t,x,y\n0,1,1\n");
+  CHECK_THROWS_WITH_AS(io::CSVTrajectory{"test.csv"}.view({1., 1., 1., 1.}),
+                       "csv file lacks some of the columns t, x, y, H: a trajectory view needs all four.", std::runtime_error);
+  for (char const* row : {"0,1,1\n", "0,1,1,1,1\n", "0,1,a,1\n", "0,1,,1\n", "0,1, 1,1\n", "0;1;1;1\n", "\n0,1,1,1\n"}) {
+    write_file("test.csv", std::string{"t,x,y,H\n0,1,1,1\n"} + row);
+    CHECK_THROWS_WITH_AS(io::CSVTrajectory{"test.csv"}, "invalid csv row at line 3.", std::runtime_error);
+  }
+
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  sim.evolveSteps(10);
+  io::CSVOptions options;
+  options.compression = {io::Compression::Format::gzip, 0};
+  io::outputCSV(sim, "test.csv", options);
+  CHECK_THROWS_WITH_AS(io::CSVTrajectory{"test.csv"}, "compressed csv file: decompress it with zcat or zstdcat first.",
+                       std::runtime_error);
+
+  std::filesystem::remove("test.csv");
+}
+
+TEST_CASE("Imported trajectory draws and exports like the simulation")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  sim.evolveSteps(500);
+  io::outputCSV(sim, "test.csv");
+
+  io::CSVTrajectory const csv{"test.csv"};
+  lotka_volterra::TrajectoryView const view = csv.view({1., 1., 1., 1.});
+  CHECK(view.steps() == sim.steps());
+  CHECK(view.H0() == csv.Hs()[0]);
+  CHECK(view.getParameter(2) == 1.);
+
+  lotka_volterra::Renderer r{800};
+  sf::RenderWindow window{sf::VideoMode(800, 800), "test", sf::Style::None};
+  CHECK_NOTHROW(r.draw(window, view, 250));
+  CHECK_NOTHROW(r.draw(window, view));
+
+  io::outputCSV(view, "imported.csv");
+  CHECK(read_file("test.csv") == read_file("imported.csv"));
+
+  std::filesystem::remove("test.csv");
+  std::filesystem::remove("imported.csv");
+}
@@ -0,0 +1,88 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "ensemble.hpp"
+
+namespace {
+std::vector<lotka_volterra::SystemParameters> sweep(std::size_t n)
+{
+  std::vector<lotka_volterra::SystemParameters> systems;
+  for (std::size_t i = 0; i < n; ++i) {
+    double const k = static_cast<double>(i);
+    systems.push_back({1. + 0.1 * k, 1., 1. + 0.05 * k, 1., 0.5 + 0.1 * k, 1.5});
+  }
+  systems.push_back({1., 1., 1., 1., 0., 5.});       // extinct prey
+  systems.push_back({1., 1., 1., 1., 5., 0.});       // extinct predator
+  systems.push_back({50., 1., 1., 50., 1., 1.});     // unstable at dt = 0.01
+  systems.push_back({10., 6., 4., 12., 4., 3.});
+  return systems;
+}
+} // namespace
+
+TEST_CASE("Ensemble constructor validates parameters")
+{
+  CHECK_THROWS(lotka_volterra::EnsembleSimulation{0.001, {}});
+  CHECK_THROWS(lotka_volterra::EnsembleSimulation{0.1, {{1., 1., 1., 1., 1., 1.}}});
+  CHECK_THROWS(lotka_volterra::EnsembleSimulation{0.001, {{1., 1., 1., 1., 1., 1.}, {1., -1., 1., 1., 1., 1.}}});
+  CHECK_NOTHROW(lotka_volterra::EnsembleSimulation{0.001, {{1., 1., 1., 1., 1., 1.}}});
+}
+
+TEST_CASE("Ensemble initial states match Simulation")
+{
+  auto const systems = sweep(13);
+  lotka_volterra::EnsembleSimulation ens{0.001, systems};
+
+  REQUIRE(ens.size() == systems.size());
+  for (std::size_t i = 0; i < ens.size(); ++i) {
+    auto const& p = systems[i];
+    lotka_volterra::Simulation sim{0.001, p.A, p.B, p.C, p.D, p.x0, p.y0};
+    CHECK(ens.steps(i) == sim.steps());
+    CHECK(ens.stateAt(i).H == sim.H());
+    CHECK(ens.isUnstable(i) == sim.isUnstable());
+  }
+  CHECK_THROWS_AS(ens.stateAt(ens.size()), std::out_of_range);
+}
+
+TEST_CASE("Ensemble matches Simulation::evolve bit for bit")
+{
+  double const dt = 0.01;
+  auto const systems = sweep(21);
+
+  for (std::size_t threads : {std::size_t{1}, std::size_t{3}}) {
+    lotka_volterra::EnsembleSimulation ens{dt, systems};
+    bool const completed = ens.evolveSteps(1000, threads);
+
+    bool sims_completed = true;
+    for (std::size_t i = 0; i < systems.size(); ++i) {
+      auto const& p = systems[i];
+      lotka_volterra::Simulation sim{dt, p.A, p.B, p.C, p.D, p.x0, p.y0};
+      for (std::size_t s = 0; s < 1000; ++s) {
+        if (!sim.evolve()) {
+          sims_completed = false;
+          break;
+        }
+      }
+
+      lotka_volterra::State const e = ens.stateAt(i);
+      lotka_volterra::State const r = sim.stateAt(sim.steps() - 1);
+      CHECK(e.x == r.x);
+      CHECK(e.y == r.y);
+      CHECK((e.H == r.H || (std::isinf(e.H) && std::isinf(r.H))));
+      CHECK(ens.steps(i) == sim.steps());
+      CHECK(ens.isUnstable(i) == sim.isUnstable());
+      CHECK(ens.maxRelDrift(i) == sim.maxRelDrift());
+    }
+    CHECK(completed == sims_completed);
+    CHECK(ens.unstableCount() >= 3);
+  }
+}
+
+TEST_CASE("Ensemble evolves with time T")
+{
+  lotka_volterra::EnsembleSimulation ens{0.001, {{1., 1., 1., 1., 10., 5.}, {1., 1., 1., 1., 2., 3.}}};
+  CHECK(ens.evolveTime(0.1));
+  CHECK(ens.steps(0) == 101);
+  CHECK(ens.steps(1) == 101);
+  CHECK_THROWS(ens.evolveTime(0.0001));
+  CHECK_THROWS(ens.evolveSteps(10, 0));
+}
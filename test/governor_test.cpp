@@ -0,0 +1,68 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "governor.hpp"
+#include <thread>
+
+TEST_CASE("Governor runs within the frame budget")
+{
+  lotka_volterra::Governor governor{100.}; // 10 ms frames, 5 ms for the simulation
+  CHECK(governor.speed() == 0.);
+  CHECK(governor.budget() == doctest::Approx(0.005));
+  CHECK(governor.frameSeconds() == 0.);
+  CHECK(governor.stepsPerSecond() == 0.);
+
+  lotka_volterra::Simulation sim{0.001, 10., 6., 4., 12., 4., 3., lotka_volterra::Integrator::RK4};
+  std::size_t total = 0;
+  for (int frame = 0; frame < 5; ++frame) {
+    auto const start        = std::chrono::steady_clock::now();
+    std::size_t const added = governor.frame(sim);
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds{4}); // the budget, less its last adaptation
+    CHECK(added > 0);
+    total += added;
+  }
+  CHECK(sim.steps() == total + 1);
+  CHECK(governor.frameSeconds() > 0.);
+  CHECK(governor.stepsPerSecond() > 0.);
+  CHECK(governor.frame(sim, 10) <= 10);
+
+  // frames late by far: the budget shrinks to its minimum, and grows back once they are on time
+  for (int frame = 0; frame < 6; ++frame) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{30});
+    governor.frame(sim, 0);
+  }
+  CHECK(governor.budget() == doctest::Approx(0.005 / 16.));
+  for (int frame = 0; frame < 40; ++frame) {
+    governor.frame(sim, 0);
+  }
+  CHECK(governor.budget() == doctest::Approx(0.005));
+}
+
+TEST_CASE("Governor keeps the simulated time at the speed factor")
+{
+  lotka_volterra::Governor governor{100.};
+  governor.setSpeed(0.5); // 0.5 simulated seconds per second
+
+  lotka_volterra::Simulation sim{0.001, 10., 6., 4., 12., 4., 3., lotka_volterra::Integrator::RK4};
+  CHECK(governor.frame(sim) == 0); // the pace starts from the first frame
+  double wall = 0.;
+  for (int frame = 0; frame < 10; ++frame) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    governor.frame(sim);
+    wall += governor.frameSeconds();
+  }
+  CHECK(sim.time() <= 0.5 * wall);
+  CHECK(sim.time() > 0.5 * wall - 0.001);
+
+  // a pause: the pace restarts without catching up
+  governor.setSpeed(0.5);
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  double const paused = sim.time();
+  CHECK(governor.frame(sim) == 0);
+  CHECK(sim.time() == paused);
+
+  CHECK_THROWS_AS(governor.setSpeed(-1.), std::invalid_argument);
+  CHECK_THROWS_AS(governor.setSpeed(HUGE_VAL), std::invalid_argument);
+  CHECK_THROWS_AS(lotka_volterra::Governor{0.}, std::invalid_argument);
+  CHECK_THROWS_AS((lotka_volterra::Governor{60., 1.5}), std::invalid_argument);
+}
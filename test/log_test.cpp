@@ -0,0 +1,107 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "log.hpp"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+namespace {
+std::size_t count_lines(std::string const& text)
+{
+  return static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n'));
+}
+} // namespace
+
+TEST_CASE("Logger writes text and JSON lines above its level")
+{
+  std::ostringstream text;
+  std::ostringstream json;
+  {
+    io::Logger logger{io::LogLevel::info};
+    logger.addOutput(text);
+    logger.addOutput(json, io::LogFormat::json);
+    logger.log(io::LogLevel::debug, "hidden");
+    logger.log(io::LogLevel::warning, "say \"hi\"\n");
+    logger.logState(io::LogLevel::info, 1000, 1., {1.5, 0.25, 2.});
+    logger.setLevel(io::LogLevel::error);
+    CHECK(!logger.enabled(io::LogLevel::warning));
+    logger.logState(io::LogLevel::info, 2000, 2., {1., 1., 1.});
+    logger.log(io::LogLevel::error, std::string(200, 'a')); // cut to max_message
+  }
+
+  CHECK(text.str()
+        == "[warning] say \"hi\"\n\n"
+           "[info] step 1000 | t = 1 | x = 1.5 | y = 0.25 | H = 2\n"
+           "[error] "
+               + std::string(io::Logger::max_message, 'a') + "\n");
+
+  std::string const lines = json.str();
+  CHECK(count_lines(lines) == 3);
+  CHECK(lines.find("\"level\":\"warning\",\"message\":\"say \\\"hi\\\"\\u000a\"}") != std::string::npos);
+  CHECK(lines.find("\"level\":\"info\",\"step\":1000,\"t\":1,\"x\":1.5,\"y\":0.25,\"H\":2}") != std::string::npos);
+  CHECK(lines.find("hidden") == std::string::npos);
+  CHECK(lines.find("2000") == std::string::npos);
+
+  CHECK_THROWS_AS(io::Logger(io::LogLevel::info, 0), std::invalid_argument);
+  CHECK_THROWS_AS(io::Logger(io::LogLevel::info, 16, std::chrono::milliseconds{0}), std::invalid_argument);
+}
+
+TEST_CASE("Log sink samples the states of a run")
+{
+  std::ostringstream out;
+  {
+    io::Logger logger;
+    logger.addOutput(out);
+    lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7, lotka_volterra::Integrator::RK4};
+    io::LogSink every_steps{logger, {1000, 0.}};
+    sim.addSink(every_steps);
+    sim.evolveSteps(5500);
+    sim.removeSink(every_steps);
+
+    io::LogSink every_seconds{logger, {0, 3600.}, io::LogLevel::debug}; // below the level: never logged
+    sim.addSink(every_seconds);
+    sim.evolveSteps(1000);
+  }
+  std::string const lines = out.str();
+  CHECK(count_lines(lines) == 6); // steps 0, 1000, ..., 5000
+  CHECK(lines.find("[info] step 0 | t = 0 |") == 0);
+  CHECK(lines.find("[info] step 5000 | t = 5 |") != std::string::npos);
+
+  io::Logger logger;
+  CHECK_THROWS_AS(io::LogSink(logger, {0, -1.}), std::invalid_argument);
+  CHECK_THROWS_AS(io::LogSink(logger, {0, std::numeric_limits<double>::infinity()}), std::invalid_argument);
+}
+
+TEST_CASE("Logger takes records from several threads and reports the ones dropped")
+{
+  std::ostringstream out;
+  {
+    io::Logger logger{io::LogLevel::info, 1 << 16};
+    logger.addOutput(out);
+    std::vector<std::jthread> threads;
+    for (std::size_t i = 0; i < 4; ++i) {
+      threads.emplace_back([&logger, i] {
+        for (std::size_t step = 0; step < 1000; ++step) {
+          logger.logState(io::LogLevel::info, step, static_cast<double>(i), {1., 1., 1.});
+        }
+      });
+    }
+  }
+  CHECK(count_lines(out.str()) == 4000);
+
+  std::ostringstream full;
+  {
+    io::Logger logger{io::LogLevel::info, 8, std::chrono::hours{1}}; // nothing written out until flush
+    logger.addOutput(full);
+    for (std::size_t i = 0; i < 20; ++i) {
+      logger.log(io::LogLevel::info, "message");
+    }
+    CHECK(logger.dropped() == 12);
+    logger.flush();
+    CHECK(logger.dropped() == 0);
+  }
+  CHECK(full.str().starts_with("[warning] 12 log records dropped: the ring was full\n"));
+  CHECK(count_lines(full.str()) == 9);
+}
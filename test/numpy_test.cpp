@@ -0,0 +1,176 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "numpy.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+std::string read_file(std::string const& filename)
+{
+  std::ifstream file{filename, std::ios::binary};
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+std::string raw(void const* data, std::size_t size)
+{
+  return std::string(static_cast<char const*>(data), size);
+}
+
+std::string column(std::span<double const> values)
+{
+  return raw(values.data(), values.size_bytes());
+}
+
+// magic string, version 1.0, header length, then the dictionary padded to a 64-byte boundary
+std::string npy_header(std::string const& dict)
+{
+  std::size_t const size = dict.size() + 64 - (10 + dict.size() + 1) % 64 + 1;
+  std::string header     = std::string("\x93NUMPY\x01\x00", 8) + static_cast<char>(size & 0xff) + static_cast<char>(size >> 8);
+  return header + dict + std::string(size - dict.size() - 1, ' ') + "\n";
+}
+
+std::uint32_t read32(std::string const& bytes, std::size_t offset)
+{
+  std::uint32_t value;
+  std::memcpy(&value, bytes.data() + offset, sizeof value);
+  return value;
+}
+
+std::uint16_t read16(std::string const& bytes, std::size_t offset)
+{
+  std::uint16_t value;
+  std::memcpy(&value, bytes.data() + offset, sizeof value);
+  return value;
+}
+
+std::uint32_t bitwise_crc32(std::string const& bytes)
+{
+  std::uint32_t crc = 0xFFFFFFFFu;
+  for (char c : bytes) {
+    crc ^= static_cast<unsigned char>(c);
+    for (int k = 0; k < 8; ++k) {
+      crc = (crc & 1u) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+} // namespace
+
+TEST_CASE("NPY trajectory header and layout match the format byte for byte")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  sim.evolveSteps(9);
+  io::outputNPY(sim, "test.npy");
+
+  std::string const bytes  = read_file("test.npy");
+  std::string const header = npy_header("{'descr': '<f8', 'fortran_order': True, 'shape': (10, 4), }");
+  REQUIRE(header.size() == 128);
+  CHECK(bytes == header + column(sim.ts()) + column(sim.xs()) + column(sim.ys()) + column(sim.Hs()));
+
+  std::filesystem::remove("test.npy");
+}
+
+TEST_CASE("NPY ensemble is a 2-D array of the current states")
+{
+  lotka_volterra::EnsembleSimulation ensemble{0.001, {{1., 1., 1., 1., 1.5, 1.5}, {1.2, 0.8, 1., 1., 1., 2.}, {1., 1., 1., 1., 0., 5.}}};
+  ensemble.evolveSteps(100);
+  io::outputNPY(ensemble, "test.npy");
+
+  std::string expected = npy_header("{'descr': '<f8', 'fortran_order': True, 'shape': (3, 3), }");
+  for (std::size_t c = 0; c < 3; ++c) {
+    for (std::size_t i = 0; i < 3; ++i) {
+      lotka_volterra::State const state = ensemble.stateAt(i);
+      double const value                = (c == 0) ? state.x : (c == 1) ? state.y : state.H;
+      expected += raw(&value, sizeof value);
+    }
+  }
+  CHECK(read_file("test.npy") == expected);
+
+  std::filesystem::remove("test.npy");
+}
+
+TEST_CASE("NPZ trajectory is a stored zip of one array per column")
+{
+  lotka_volterra::Simulation sim{0.01, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7, lotka_volterra::Integrator::RK4};
+  sim.evolveSteps(99);
+  io::outputNPZ(sim, "test.npz");
+  std::string const bytes = read_file("test.npz");
+
+  std::array<double, 4> const pars{1.1, 0.9, 1.2, 0.8};
+  std::string const one_d = "{'descr': '<f8', 'fortran_order': False, 'shape': (100,), }";
+  std::vector<std::pair<std::string, std::string>> const entries{
+      {"t.npy", npy_header(one_d) + column(sim.ts())},
+      {"x.npy", npy_header(one_d) + column(sim.xs())},
+      {"y.npy", npy_header(one_d) + column(sim.ys())},
+      {"H.npy", npy_header(one_d) + column(sim.Hs())},
+      {"parameters.npy", npy_header("{'descr': '<f8', 'fortran_order': False, 'shape': (4,), }") + raw(pars.data(), 32)}};
+
+  std::size_t offset = 0;
+  std::vector<std::size_t> offsets;
+  for (auto const& [name, data] : entries) {
+    offsets.push_back(offset);
+    CHECK(read32(bytes, offset) == 0x04034b50);
+    CHECK(read16(bytes, offset + 8) == 0); // stored
+    CHECK(read32(bytes, offset + 14) == bitwise_crc32(data));
+    CHECK(read32(bytes, offset + 18) == data.size());
+    CHECK(read32(bytes, offset + 22) == data.size());
+    REQUIRE(read16(bytes, offset + 26) == name.size());
+    CHECK(read16(bytes, offset + 28) == 0);
+    CHECK(bytes.compare(offset + 30, name.size(), name) == 0);
+    CHECK(bytes.compare(offset + 30 + name.size(), data.size(), data) == 0);
+    offset += 30 + name.size() + data.size();
+  }
+
+  std::size_t const end = bytes.size() - 22;
+  CHECK(read32(bytes, end) == 0x06054b50);
+  CHECK(read16(bytes, end + 10) == entries.size());
+  CHECK(read32(bytes, end + 16) == offset); // central directory right after the entries
+  CHECK(read32(bytes, end + 12) == end - offset);
+
+  std::size_t central = offset;
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    CHECK(read32(bytes, central) == 0x02014b50);
+    CHECK(read32(bytes, central + 16) == bitwise_crc32(entries[i].second));
+    CHECK(read32(bytes, central + 42) == offsets[i]);
+    CHECK(bytes.compare(central + 46, entries[i].first.size(), entries[i].first) == 0);
+    central += 46 + entries[i].first.size();
+  }
+  CHECK(central == end);
+
+  std::filesystem::remove("test.npz");
+}
+
+TEST_CASE("NPZ ensemble has one entry per column with its dtype")
+{
+  lotka_volterra::EnsembleSimulation ensemble{0.01, {{1., 1., 1., 1., 1.5, 1.5}, {50., 1., 1., 50., 1., 1.}}};
+  ensemble.evolveSteps(10000);
+  REQUIRE(ensemble.isUnstable(1));
+  io::outputNPZ(ensemble, "test.npz");
+  std::string const bytes = read_file("test.npz");
+
+  std::uint64_t const steps[2] = {ensemble.steps(0), ensemble.steps(1)};
+  std::string const expected_steps =
+      npy_header("{'descr': '<u8', 'fortran_order': False, 'shape': (2,), }") + raw(steps, sizeof steps);
+  std::string const expected_unstable = npy_header("{'descr': '|b1', 'fortran_order': False, 'shape': (2,), }") + std::string("\0\1", 2);
+
+  CHECK(bytes.find(expected_steps) != std::string::npos);
+  CHECK(bytes.find(expected_unstable) != std::string::npos);
+  for (char const* name : {"x.npy", "y.npy", "H.npy", "max_rel_drift.npy", "steps.npy", "unstable.npy"}) {
+    CHECK(bytes.find(name) != std::string::npos);
+  }
+  CHECK(read16(bytes, bytes.size() - 12) == 6);
+
+  std::filesystem::remove("test.npz");
+}
+
+TEST_CASE("NumPy export throws if the file cannot be opened")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1., 1.};
+  CHECK_THROWS(io::outputNPY(sim, "missing_directory/test.npy"));
+  CHECK_THROWS(io::outputNPZ(sim, "missing_directory/test.npz"));
+}
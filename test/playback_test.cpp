@@ -0,0 +1,138 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "playback.hpp"
+#include <algorithm>
+#include <random>
+
+TEST_CASE("Playback advances by states per frame, backwards and paused")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  sim.evolveSteps(99);
+  REQUIRE(sim.steps() == 100);
+
+  lotka_volterra::Playback playback{sim};
+  CHECK(playback.mode() == lotka_volterra::Playback::Mode::steps);
+  CHECK(playback.step() == 1);
+  CHECK(playback.atStart());
+  CHECK(playback.time() == sim.ts()[0]);
+
+  playback.advance(0.);
+  CHECK(playback.step() == 2);
+  playback.setStepsPerFrame(0.5); // one state every other frame
+  playback.advance(0.);
+  CHECK(playback.step() == 2);
+  playback.advance(0.);
+  CHECK(playback.step() == 3);
+  CHECK(playback.time() == sim.ts()[2]);
+
+  playback.setStepsPerFrame(40.);
+  playback.pause();
+  playback.advance(0.);
+  CHECK(playback.step() == 3);
+  playback.togglePause();
+  CHECK(!playback.isPaused());
+  playback.advance(0.);
+  playback.advance(0.);
+  CHECK(playback.step() == 83);
+  playback.advance(0.);
+  CHECK(playback.step() == 100); // stops at the last state
+  CHECK(playback.atEnd());
+
+  playback.setStepsPerFrame(-60.);
+  playback.advance(0.);
+  CHECK(playback.step() == 40);
+  playback.advance(0.);
+  CHECK(playback.step() == 1);
+  CHECK(playback.atStart());
+
+  playback.seekStep(50);
+  CHECK(playback.step() == 50);
+  playback.seekStep(1000);
+  CHECK(playback.step() == 100);
+  playback.seekStep(0);
+  CHECK(playback.step() == 1);
+  playback.seekStep(70);
+  playback.rewind();
+  CHECK(playback.step() == 1);
+}
+
+TEST_CASE("Playback seeks and plays by simulated time on an irregular grid")
+{
+  lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7, lotka_volterra::Integrator::DormandPrince};
+  std::mt19937 rng{5};
+  std::uniform_real_distribution<double> gap{0.0001, 0.002};
+  std::vector<double> times;
+  double t = 0.;
+  for (std::size_t i = 0; i < 3 * lotka_volterra::Playback::keyframe_interval + 123; ++i) {
+    t += gap(rng);
+    times.push_back(t);
+  }
+  REQUIRE(sim.evolveGrid(times));
+  std::span<double const> const ts = sim.ts();
+
+  lotka_volterra::Playback playback{sim};
+  std::uniform_real_distribution<double> seek{-0.1, ts.back() + 0.1};
+  for (int i = 0; i < 2000; ++i) {
+    double const target = (i % 2 == 0) ? seek(rng) : ts[static_cast<std::size_t>(i) % ts.size()]; // also exactly on a state
+    playback.seekTime(target);
+    auto const next = std::upper_bound(ts.begin(), ts.end(), target);
+    CHECK(playback.step() == std::max<std::size_t>(static_cast<std::size_t>(next - ts.begin()), 1));
+  }
+  CHECK_THROWS_AS(playback.seekTime(std::nan("")), std::invalid_argument);
+
+  playback.seekTime(1.);
+  playback.setTimeRate(2.);
+  CHECK(playback.mode() == lotka_volterra::Playback::Mode::time);
+  for (int frame = 1; frame <= 10; ++frame) {
+    playback.advance(0.01); // the clock keeps the fraction between two states
+    double const clock = 1. + 0.02 * frame;
+    CHECK(playback.time() <= clock);
+    CHECK(ts[playback.step()] > clock);
+  }
+  playback.setTimeRate(-100.);
+  playback.advance(1.);
+  CHECK(playback.atStart());
+  playback.setTimeRate(100.);
+  playback.advance(1.);
+  CHECK(playback.atEnd());
+}
+
+TEST_CASE("Playback rejects invalid trajectories and speeds")
+{
+  lotka_volterra::Simulation bounded{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  bounded.setHistory(10);
+  bounded.evolveSteps(100);
+  CHECK_THROWS_AS(lotka_volterra::Playback{bounded}, std::invalid_argument);
+
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  sim.evolveSteps(10);
+  lotka_volterra::Playback playback{sim};
+  CHECK_THROWS_AS(playback.setStepsPerFrame(HUGE_VAL), std::invalid_argument);
+  CHECK_THROWS_AS(playback.setTimeRate(std::nan("")), std::invalid_argument);
+  CHECK_THROWS_AS(playback.advance(-1.), std::invalid_argument);
+  CHECK(playback.mode() == lotka_volterra::Playback::Mode::steps);
+  CHECK(playback.speed() == 1.);
+}
+
+TEST_CASE("Playback draws after seeking in both directions")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  sim.evolveSteps(5 * lotka_volterra::Playback::keyframe_interval);
+
+  lotka_volterra::Playback playback{sim};
+  lotka_volterra::Renderer r{800};
+  sf::RenderWindow window{sf::VideoMode(800, 800), "test", sf::Style::None};
+
+  CHECK_NOTHROW(playback.draw(r, window));
+  for (std::size_t step : {100u, 9000u, 20480u, 4096u, 4095u, 1u, 20481u, 12345u}) {
+    playback.seekStep(step);
+    CHECK_NOTHROW(playback.draw(r, window));
+  }
+  playback.setStepsPerFrame(-1000.);
+  for (int frame = 0; frame < 30; ++frame) {
+    playback.advance(0.);
+    CHECK_NOTHROW(playback.draw(r, window));
+  }
+  CHECK(playback.atStart());
+}
@@ -0,0 +1,115 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "queue.hpp"
+#include "renderer.hpp"
+#include <thread>
+
+namespace {
+struct Recorder : lotka_volterra::StateSink
+{
+  std::vector<std::size_t> steps;
+  std::vector<double> ts;
+  std::vector<double> xs;
+
+  void consume(std::size_t step, double t, lotka_volterra::State const& state) override
+  {
+    steps.push_back(step);
+    ts.push_back(t);
+    xs.push_back(state.x);
+  }
+};
+} // namespace
+
+TEST_CASE("State queue hands over full and partial chunks in order")
+{
+  lotka_volterra::StateQueue queue{4};
+  Recorder recorder;
+  std::size_t const n = 2 * lotka_volterra::StateQueue::chunk_states + 10;
+  for (std::size_t i = 0; i < n; ++i) {
+    queue.consume(i, 0.5 * static_cast<double>(i), {static_cast<double>(i), 1., 2.});
+  }
+  CHECK(queue.drain(recorder) == 2 * lotka_volterra::StateQueue::chunk_states); // the last states are not published yet
+  queue.publish();
+  CHECK(queue.drain(recorder) == 10);
+  CHECK(queue.drain(recorder) == 0);
+  CHECK(!queue.exhausted());
+
+  queue.consume(n, 1., {1., 1., 1.});
+  queue.finish();
+  CHECK(!queue.exhausted());
+  CHECK(queue.drain(recorder) == 1);
+  CHECK(queue.exhausted());
+  CHECK(queue.received() == n + 1);
+  CHECK(queue.time() == 1.);
+
+  REQUIRE(recorder.steps.size() == n + 1);
+  bool ordered = true;
+  for (std::size_t i = 0; i < n; ++i) {
+    ordered = ordered && recorder.steps[i] == i && recorder.ts[i] == 0.5 * static_cast<double>(i) && recorder.xs[i] == static_cast<double>(i);
+  }
+  CHECK(ordered);
+  CHECK_THROWS_AS(lotka_volterra::StateQueue{0}, std::invalid_argument);
+}
+
+TEST_CASE("State queue carries a run between threads without losing states")
+{
+  lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7, lotka_volterra::Integrator::RK4};
+  lotka_volterra::StateQueue queue{2}; // the producer has to wait for the consumer
+  Recorder recorder;
+  sim.addSink(queue);
+
+  std::thread producer{[&] {
+    for (int batch = 0; batch < 100; ++batch) {
+      sim.evolveSteps(997);
+      queue.publish();
+    }
+    queue.finish();
+  }};
+  while (!queue.exhausted()) {
+    queue.drain(recorder);
+  }
+  producer.join();
+
+  REQUIRE(recorder.steps.size() == sim.steps());
+  bool same = true;
+  for (std::size_t i = 0; i < sim.steps(); ++i) {
+    same = same && recorder.steps[i] == i && recorder.ts[i] == sim.ts()[i] && recorder.xs[i] == sim.xs()[i];
+  }
+  CHECK(same);
+}
+
+TEST_CASE("Closed state queue does not block the producer")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5, lotka_volterra::Integrator::RK4};
+  lotka_volterra::StateQueue queue{1};
+  sim.addSink(queue);
+
+  std::thread producer{[&] {
+    sim.evolveSteps(10 * lotka_volterra::StateQueue::chunk_states); // the ring fills up after one chunk
+    queue.finish();
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  queue.close();
+  producer.join();
+  CHECK(sim.steps() == 10 * lotka_volterra::StateQueue::chunk_states + 1);
+}
+
+TEST_CASE("Renderer draws the states drained from the queue")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  lotka_volterra::Renderer r{800};
+  lotka_volterra::RendererFeed feed{r, sim};
+  lotka_volterra::StateQueue queue;
+  sf::RenderWindow window{sf::VideoMode(800, 800), "test", sf::Style::None};
+  sim.addSink(queue);
+
+  for (int frame = 0; frame < 10; ++frame) {
+    sim.evolveSteps(300);
+    queue.publish();
+    queue.drain(feed);
+    lotka_volterra::TrajectoryView const arrived{{}, {}, {}, {}, {1., 1., 1., 1.}, sim.H0(), queue.received()};
+    CHECK_NOTHROW(r.draw(window, arrived)); // only what arrived, nothing read from the simulation
+  }
+  CHECK(queue.received() == sim.steps());
+}
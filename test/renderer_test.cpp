@@ -2,6 +2,8 @@
 #include "doctest.h"
 
 #include "input.hpp"
+#include <format>
+#include <thread>
 
 TEST_CASE("Renderer constructor rejects width and height out of range")
 {
@@ -35,6 +37,53 @@ TEST_CASE("Renderer draws by step without crashing")
   CHECK_NOTHROW(r.draw(window, sim, 6));
 }
 
+TEST_CASE("Renderer draws incrementally and after rewinding")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1., 1.};
+  sim.evolveSteps(100);
+
+  lotka_volterra::Renderer r{800};
+  sf::RenderWindow window{sf::VideoMode(800, 800), "test", sf::Style::None};
+
+  for (std::size_t step = 1; step <= sim.steps(); ++step) {
+    CHECK_NOTHROW(r.draw(window, sim, step));
+  }
+  CHECK_NOTHROW(r.draw(window, sim, 10));
+  CHECK_NOTHROW(r.draw(window, sim));
+}
+
+TEST_CASE("Renderer draws an adaptive simulation from its output grid")
+{
+  lotka_volterra::Simulation sim{0.05, 1., 1., 1., 1., 1.5, 1., lotka_volterra::Integrator::DormandPrince};
+  sim.evolveTime(5.);
+
+  lotka_volterra::Renderer r{800};
+  sf::RenderWindow window{sf::VideoMode(800, 800), "test", sf::Style::None};
+
+  CHECK(sim.steps() == 101);
+  CHECK_NOTHROW(r.draw(window, sim, 50));
+  CHECK_NOTHROW(r.draw(window, sim));
+}
+
+TEST_CASE("Renderer feed draws a bounded simulation")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1., 1.};
+  sim.setHistory(8);
+
+  lotka_volterra::Renderer r{800};
+  lotka_volterra::RendererFeed feed{r, sim};
+  sf::RenderWindow window{sf::VideoMode(800, 800), "test", sf::Style::None};
+  sim.addSink(feed);
+
+  for (int i = 0; i < 100; ++i) {
+    sim.evolve();
+    CHECK_NOTHROW(r.draw(window, sim));
+  }
+
+  lotka_volterra::Renderer unfed{800};
+  CHECK_THROWS_AS(unfed.draw(window, sim), std::out_of_range);
+}
+
 TEST_CASE("Renderer sets draw and draws components without crashing")
 {
   lotka_volterra::Renderer r{800};
@@ -49,6 +98,51 @@ TEST_CASE("Renderer sets draw and draws components without crashing")
   CHECK_NOTHROW(r.drawTrajectory(window, s, 1, view));
 }
 
+TEST_CASE("Renderer HUD shows the run and updates a few times per second")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.};
+  sim.evolveSteps(100);
+
+  lotka_volterra::Renderer r{800};
+  sf::RenderWindow window{sf::VideoMode(800, 800), "test", sf::Style::None};
+  CHECK(!r.hud());
+  r.draw(window, sim);
+  CHECK(r.hudText().empty()); // off by default
+
+  r.setHud(true);
+  r.setHudStats({2e6, sim.steps(), sim.stateBytes(), 50. * sim.dt()});
+  r.draw(window, sim);
+  std::string const text = r.hudText();
+  std::span<double const> const Hs = sim.Hs();
+  double const drift               = std::abs(Hs[100] - Hs[99]) / std::abs(Hs[99]);
+  CHECK(text.starts_with("frame p50 "));
+  CHECK(text.find("steps/s 2e+06 | states 101\n") != std::string::npos);
+  CHECK(sim.stateBytes() == 4 * 101 * sizeof(double)); // the stored states, not the reserved range
+  CHECK(text.find("memory states 0.0 | vertices ") != std::string::npos);
+  CHECK(text.find(std::format("dH/H {:.2e} | tolerance 5.00e-02", drift)) != std::string::npos);
+
+  r.setHudStats({1e6, 1, 0, 0.});
+  for (int i = 0; i < 10; ++i) {
+    r.draw(window, sim);
+  }
+  CHECK(r.hudText() == text); // not before hud_interval_
+  std::this_thread::sleep_for(std::chrono::milliseconds{300});
+  r.draw(window, sim);
+  CHECK(r.hudText().find("steps/s 1e+06 | states 1\n") != std::string::npos);
+  std::string const updated = r.hudText();
+  CHECK(std::stod(updated.substr(updated.find("p99 ") + 4)) >= 300.); // the frames drawn meanwhile, the last one 300 ms long
+
+  lotka_volterra::Renderer fed{800}; // the drift of the states appended by a feed
+  lotka_volterra::RendererFeed feed{fed, sim};
+  sim.addSink(feed);
+  sim.evolve();
+  fed.setHud(true);
+  fed.draw(window, lotka_volterra::TrajectoryView{{}, {}, {}, {}, {1., 1., 1., 1.}, sim.H0(), sim.steps()});
+  double const last_drift = std::abs(sim.Hs()[101] - sim.Hs()[100]) / std::abs(sim.Hs()[100]);
+  CHECK(fed.hudText().find(std::format("dH/H {:.2e}", last_drift)) != std::string::npos);
+  sim.removeSink(feed);
+}
+
 TEST_CASE("Renderer input creates a proper renderer")
 {
   lotka_volterra::Renderer r = io::inputRenderer(800);
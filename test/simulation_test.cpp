@@ -3,6 +3,9 @@
 
 #include "input.hpp"
 #include "output.hpp"
+#include "statistics.hpp"
+#include <algorithm>
+#include <filesystem>
 
 TEST_CASE("Simulation constructor works and initialize correctly")
 {
@@ -31,6 +34,25 @@ TEST_CASE("Simulation evolves correctly")
   CHECK(s.y >= 0.);
 }
 
+TEST_CASE("Simulation columns match states")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 2., 3.};
+  sim.evolveSteps(50);
+
+  CHECK(sim.xs().size() == sim.steps());
+  CHECK(sim.ys().size() == sim.steps());
+  CHECK(sim.Hs().size() == sim.steps());
+
+  for (std::size_t i = 0; i < sim.steps(); ++i) {
+    lotka_volterra::State const s = sim.stateAt(i);
+    CHECK(s.x == sim.xs()[i]);
+    CHECK(s.y == sim.ys()[i]);
+    CHECK(s.H == sim.Hs()[i]);
+  }
+  CHECK(sim.H() == sim.Hs().back());
+  CHECK_THROWS_AS(sim.stateAt(sim.steps()), std::out_of_range);
+}
+
 TEST_CASE("lotka_volterra::Simulation constructor throws on invalid parameters")
 {
   CHECK_THROWS(lotka_volterra::Simulation{0., 1., 1., 1., 1.});
@@ -62,6 +84,84 @@ TEST_CASE("Evolve with time T")
   CHECK_NOTHROW(sim.evolveTime(0.001));
 }
 
+TEST_CASE("Evolve until a deadline")
+{
+  using Clock = std::chrono::steady_clock;
+  lotka_volterra::Simulation sim{0.001, 10., 6., 4., 12., 4., 3., lotka_volterra::Integrator::RK4};
+  CHECK(sim.evolveFor(Clock::now() - std::chrono::seconds{1}) == 0); // already past
+
+  Clock::time_point const start = Clock::now();
+  std::size_t const added       = sim.evolveFor(start + std::chrono::milliseconds{20});
+  CHECK(Clock::now() - start >= std::chrono::milliseconds{20});
+  CHECK(Clock::now() - start < std::chrono::milliseconds{500}); // small batches near the deadline, even when busy
+  CHECK(added > 16);
+  CHECK(sim.steps() == added + 1);
+
+  CHECK(sim.evolveFor(Clock::now() + std::chrono::hours{1}, 1000) == 1000); // the step limit comes first
+
+  lotka_volterra::Simulation bulk{0.001, 10., 6., 4., 12., 4., 3., lotka_volterra::Integrator::RK4};
+  bulk.evolveSteps(sim.steps() - 1); // the same states as in batches
+  bool close = true;
+  for (std::size_t i = 0; i < bulk.steps(); ++i) {
+    close = close && sim.xs()[i] == doctest::Approx(bulk.xs()[i]).epsilon(1e-10) && sim.ys()[i] == doctest::Approx(bulk.ys()[i]).epsilon(1e-10);
+  }
+  CHECK(close);
+
+  lotka_volterra::Simulation unstable{0.01, 50., 1., 1., 50., 1., 1.};
+  lotka_volterra::Simulation reference{0.01, 50., 1., 1., 50., 1., 1.};
+  reference.evolveSteps(1000);
+  CHECK(unstable.evolveFor(Clock::now() + std::chrono::hours{1}) == reference.steps() - 1); // stops on the instability
+  CHECK(unstable.isUnstable());
+}
+
+TEST_CASE("Bulk evolution matches single steps within tolerance")
+{
+  lotka_volterra::Simulation bulk{0.001, 10., 6., 4., 12., 4., 3.};
+  lotka_volterra::Simulation single{0.001, 10., 6., 4., 12., 4., 3.};
+
+  CHECK(bulk.evolveSteps(10000));
+  for (int i = 0; i < 10000; ++i) {
+    single.evolve();
+  }
+
+  REQUIRE(bulk.steps() == single.steps());
+  for (std::size_t i = 0; i < bulk.steps(); ++i) {
+    CHECK(bulk.xs()[i] == doctest::Approx(single.xs()[i]).epsilon(1e-10));
+    CHECK(bulk.ys()[i] == doctest::Approx(single.ys()[i]).epsilon(1e-10));
+    CHECK(bulk.Hs()[i] == doctest::Approx(single.Hs()[i]).epsilon(1e-10));
+  }
+
+  lotka_volterra::Simulation unstable_bulk{0.01, 50., 1., 1., 50., 1., 1.};
+  lotka_volterra::Simulation unstable_single{0.01, 50., 1., 1., 50., 1., 1.};
+  CHECK_FALSE(unstable_bulk.evolveSteps(1000));
+  while (unstable_single.evolve()) {
+  }
+  CHECK(unstable_bulk.steps() == unstable_single.steps());
+  CHECK(unstable_bulk.maxRelDrift() == doctest::Approx(unstable_single.maxRelDrift()));
+}
+
+TEST_CASE("Chunked validation does not depend on the chunk size")
+{
+  for (std::size_t chunk : {std::size_t{1}, std::size_t{7}, std::size_t{4096}}) {
+    lotka_volterra::Simulation reference{0.01, 50., 1., 1., 50., 1., 1.};
+    lotka_volterra::Simulation chunked{0.01, 50., 1., 1., 50., 1., 1.};
+    reference.setChunkSize(1);
+    chunked.setChunkSize(chunk);
+
+    CHECK(reference.evolveSteps(1000) == chunked.evolveSteps(1000));
+    REQUIRE(reference.steps() == chunked.steps());
+    CHECK(reference.isUnstable() == chunked.isUnstable());
+    CHECK(reference.maxRelDrift() == chunked.maxRelDrift());
+    for (std::size_t i = 0; i < reference.steps(); ++i) {
+      CHECK(reference.stateAt(i).x == chunked.stateAt(i).x);
+      CHECK(reference.stateAt(i).H == chunked.stateAt(i).H);
+    }
+  }
+
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 2., 3.};
+  CHECK_THROWS(sim.setChunkSize(0));
+}
+
 TEST_CASE("Extinction of prey keeps x at zero")
 {
   lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 0., 5.};
@@ -176,6 +276,205 @@ TEST_CASE("Trajectory convergence for dt -> 0")
   }
 }
 
+TEST_CASE("Integrator selects the allowed dt range")
+{
+  using lotka_volterra::Integrator;
+  CHECK_THROWS(lotka_volterra::Simulation{0.05, 1., 1., 1., 1., 1., 1., Integrator::Euler});
+  CHECK_NOTHROW(lotka_volterra::Simulation{0.05, 1., 1., 1., 1., 1., 1., Integrator::Heun});
+  CHECK_THROWS(lotka_volterra::Simulation{0.1, 1., 1., 1., 1., 1., 1., Integrator::Heun});
+  CHECK_NOTHROW(lotka_volterra::Simulation{0.1, 1., 1., 1., 1., 1., 1., Integrator::RK4});
+  CHECK_THROWS(lotka_volterra::Simulation{0.2, 1., 1., 1., 1., 1., 1., Integrator::RK4});
+
+  lotka_volterra::Simulation sim{0.01, 1., 1., 1., 1., 1., 1., Integrator::RK4};
+  CHECK(sim.method() == Integrator::RK4);
+}
+
+TEST_CASE("Higher order integrators converge with their order")
+{
+  using lotka_volterra::Integrator;
+  auto final_x = [](Integrator method, double dt) {
+    lotka_volterra::Simulation sim{dt, 10., 6., 4., 12., 4., 3., method};
+    sim.evolveTime(1.);
+    return sim.stateAt(sim.steps() - 1).x;
+  };
+
+  double const reference = final_x(Integrator::RK4, 0.0001);
+
+  double const heun_ratio = std::abs(final_x(Integrator::Heun, 0.002) - reference) / std::abs(final_x(Integrator::Heun, 0.001) - reference);
+  double const rk4_ratio  = std::abs(final_x(Integrator::RK4, 0.02) - reference) / std::abs(final_x(Integrator::RK4, 0.01) - reference);
+
+  CHECK(heun_ratio == doctest::Approx(4.).epsilon(0.25));
+  CHECK(rk4_ratio == doctest::Approx(16.).epsilon(0.25));
+}
+
+TEST_CASE("RK4 conserves H with far fewer steps than Euler")
+{
+  auto max_drift = [](lotka_volterra::Simulation& sim) {
+    double drift = 0.;
+    for (double H : sim.Hs()) {
+      drift = std::max(drift, std::abs(H - sim.H0()) / std::abs(sim.H0()));
+    }
+    return drift;
+  };
+
+  lotka_volterra::Simulation euler{0.0001, 10., 6., 4., 12., 4., 3.};
+  lotka_volterra::Simulation rk4{0.05, 10., 6., 4., 12., 4., 3., lotka_volterra::Integrator::RK4};
+  CHECK(euler.evolveTime(10.));
+  CHECK(rk4.evolveTime(10.));
+
+  CHECK(rk4.steps() * 100 < euler.steps());
+  CHECK(max_drift(rk4) < max_drift(euler));
+}
+
+TEST_CASE("Adaptive integration samples the requested output grid")
+{
+  using lotka_volterra::Integrator;
+  lotka_volterra::Simulation sim{0.01, 10., 6., 4., 12., 4., 3., Integrator::DormandPrince};
+  sim.setTolerances(1e-8, 1e-11);
+
+  std::vector<double> const times{0.05, 0.3, 0.31, 1., 2.5};
+  CHECK(sim.evolveGrid(times));
+  REQUIRE(sim.steps() == times.size() + 1);
+  CHECK(sim.timeAt(0) == 0.);
+  for (std::size_t i = 0; i < times.size(); ++i) {
+    CHECK(sim.timeAt(i + 1) == times[i]);
+  }
+
+  lotka_volterra::Simulation ref{0.0001, 10., 6., 4., 12., 4., 3., Integrator::RK4};
+  ref.evolveTime(2.5);
+  for (std::size_t i = 0; i < times.size(); ++i) { // dense output between integration steps
+    auto const k = static_cast<std::size_t>(std::round(times[i] / ref.dt()));
+    CHECK(sim.stateAt(i + 1).x == doctest::Approx(ref.stateAt(k).x).epsilon(1e-6));
+    CHECK(sim.stateAt(i + 1).y == doctest::Approx(ref.stateAt(k).y).epsilon(1e-6));
+  }
+
+  std::vector<double> const past{2.5};
+  CHECK_THROWS_AS(sim.evolveGrid(past), std::invalid_argument);
+  std::vector<double> const unsorted{3., 2.9};
+  CHECK_THROWS_AS(sim.evolveGrid(unsorted), std::invalid_argument);
+
+  lotka_volterra::Simulation euler{0.001, 1., 1., 1., 1., 1., 1.};
+  CHECK_THROWS_AS(euler.evolveGrid(times), std::logic_error);
+  CHECK(euler.evolveSteps(3));
+  CHECK(euler.timeAt(3) == 3 * 0.001);
+}
+
+TEST_CASE("Adaptive steps do not depend on the output interval")
+{
+  using lotka_volterra::Integrator;
+  lotka_volterra::Simulation fine{0.01, 10., 6., 4., 12., 4., 3., Integrator::DormandPrince};
+  lotka_volterra::Simulation coarse{1., 10., 6., 4., 12., 4., 3., Integrator::DormandPrince};
+  CHECK(fine.evolveTime(10.));
+  CHECK(coarse.evolveTime(10.));
+
+  CHECK(fine.steps() == 1001);
+  CHECK(coarse.steps() == 11);
+  CHECK(fine.time() == doctest::Approx(10.));
+  for (std::size_t i = 0; i < coarse.steps(); ++i) {
+    CHECK(fine.stateAt(100 * i).x == doctest::Approx(coarse.stateAt(i).x).epsilon(1e-4));
+  }
+  CHECK(coarse.rhsEvaluations() < 2 * fine.rhsEvaluations());
+}
+
+TEST_CASE("Adaptive drift check stays bounded on a wide output interval")
+{
+  using lotka_volterra::Integrator;
+  lotka_volterra::Simulation sim{1., 10., 6., 4., 12., 4., 3., Integrator::DormandPrince};
+  sim.setTolerances(1e-2, 1e-2);
+  CHECK_FALSE(sim.evolveTime(50.)); // a 100% jump in H, well below the 50 times the interval
+  CHECK(sim.isUnstable());
+  CHECK(sim.maxRelDrift() > 1.);
+  CHECK(sim.steps() < 51);
+
+  lotka_volterra::Simulation loose{1., 10., 6., 4., 12., 4., 3., Integrator::DormandPrince};
+  loose.setTolerances(1e-3, 1e-3);
+  CHECK(loose.evolveTime(50.)); // the cap follows rtol
+}
+
+TEST_CASE("Adaptive integration needs far fewer evaluations than Euler")
+{
+  using lotka_volterra::Integrator;
+  lotka_volterra::Simulation ref{0.0001, 10., 6., 4., 12., 4., 3., Integrator::RK4};
+  lotka_volterra::Simulation euler{0.0001, 10., 6., 4., 12., 4., 3.};
+  lotka_volterra::Simulation adaptive{0.01, 10., 6., 4., 12., 4., 3., Integrator::DormandPrince};
+  adaptive.setTolerances(1e-4, 1e-7);
+  CHECK(ref.evolveTime(10.));
+  CHECK(euler.evolveTime(10.));
+  CHECK(adaptive.evolveTime(10.));
+
+  auto error = [&ref](lotka_volterra::Simulation const& sim) {
+    return std::hypot(sim.xs().back() - ref.xs().back(), sim.ys().back() - ref.ys().back());
+  };
+
+  CHECK(euler.rhsEvaluations() == 100000);
+  CHECK(adaptive.rhsEvaluations() * 20 < euler.rhsEvaluations());
+  CHECK(error(adaptive) < error(euler));
+}
+
+TEST_CASE("Splitting integrators converge with their order")
+{
+  using lotka_volterra::Integrator;
+  auto final_x = [](Integrator method, double dt) {
+    lotka_volterra::Simulation sim{dt, 10., 6., 4., 12., 4., 3., method};
+    sim.evolveTime(1.);
+    return sim.stateAt(sim.steps() - 1).x;
+  };
+
+  double const reference = final_x(Integrator::RK4, 0.0001);
+
+  double const strang_ratio  = std::abs(final_x(Integrator::Strang, 0.002) - reference) / std::abs(final_x(Integrator::Strang, 0.001) - reference);
+  double const yoshida_ratio = std::abs(final_x(Integrator::Yoshida, 0.02) - reference) / std::abs(final_x(Integrator::Yoshida, 0.01) - reference);
+
+  CHECK(strang_ratio == doctest::Approx(4.).epsilon(0.25));
+  CHECK(yoshida_ratio == doctest::Approx(16.).epsilon(0.25));
+  CHECK_THROWS(lotka_volterra::Simulation{0.1, 1., 1., 1., 1., 1., 1., Integrator::Yoshida});
+}
+
+TEST_CASE("Splitting integrators keep H bounded over long horizons")
+{
+  using lotka_volterra::Integrator;
+  auto max_drift = [](lotka_volterra::Simulation const& sim) {
+    double drift = 0.;
+    for (double H : sim.Hs()) {
+      drift = std::max(drift, std::abs(H - sim.H0()) / std::abs(sim.H0()));
+    }
+    return drift;
+  };
+
+  lotka_volterra::Simulation strang{0.05, 10., 6., 4., 12., 4., 3., Integrator::Strang};
+  lotka_volterra::Simulation yoshida{0.05, 10., 6., 4., 12., 4., 3., Integrator::Yoshida};
+  lotka_volterra::Simulation rk4{0.05, 10., 6., 4., 12., 4., 3., Integrator::RK4};
+  CHECK(strang.evolveTime(1000.));
+  CHECK(yoshida.evolveTime(1000.));
+  CHECK(rk4.evolveTime(1000.));
+
+  CHECK(max_drift(strang) < 0.05);
+  CHECK(max_drift(yoshida) < 0.05);
+  CHECK(max_drift(strang) * 5 < max_drift(rk4));
+}
+
+TEST_CASE("Splitting integrators stay positive without logarithms")
+{
+  lotka_volterra::Simulation sim{0.001, 10., 6., 4., 12., 0.05, 0.05, lotka_volterra::Integrator::Strang};
+  CHECK(sim.evolveTime(5.));
+  CHECK_FALSE(sim.isUnstable());
+
+  for (std::size_t i = 0; i < sim.steps(); ++i) {
+    lotka_volterra::State const s = sim.stateAt(i);
+    REQUIRE(s.x > 0.);
+    REQUIRE(s.y > 0.);
+    CHECK(s.H == doctest::Approx(sim.energy(s.x, s.y)).epsilon(1e-12));
+  }
+
+  lotka_volterra::Simulation single{0.001, 10., 6., 4., 12., 0.05, 0.05, lotka_volterra::Integrator::Strang};
+  for (int i = 0; i < 5000; ++i) {
+    single.evolve();
+  }
+  CHECK(single.steps() == sim.steps());
+  CHECK(single.stateAt(5000).x == doctest::Approx(sim.stateAt(5000).x).epsilon(1e-12));
+  CHECK(single.stateAt(5000).y == doctest::Approx(sim.stateAt(5000).y).epsilon(1e-12));
+}
+
 TEST_CASE("Simulation becomes unstable on large step")
 {
   lotka_volterra::Simulation sim{0.01, 50., 1., 1., 50., 1., 1.};
@@ -195,6 +494,104 @@ TEST_CASE("Last state remains valid after instability")
   CHECK(std::isfinite(last.H));
 }
 
+TEST_CASE("Bounded history keeps memory constant and results unchanged")
+{
+  lotka_volterra::Simulation full{0.001, 1., 1., 1., 1., 10., 5.};
+  lotka_volterra::Simulation bounded{0.001, 1., 1., 1., 1., 10., 5.};
+  bounded.setHistory(100);
+
+  full.evolveSteps(10000);
+  bounded.evolveSteps(10000);
+
+  CHECK(bounded.steps() == full.steps());
+  CHECK(bounded.H() == full.H());
+  CHECK(bounded.H0() == full.H0());
+  CHECK(bounded.xs().size() < 200);
+  CHECK(bounded.firstStep() + bounded.xs().size() == bounded.steps());
+
+  lotka_volterra::State const last = bounded.stateAt(bounded.steps() - 1);
+  CHECK(last.x == full.stateAt(full.steps() - 1).x);
+  CHECK_THROWS_AS(bounded.stateAt(0), std::out_of_range);
+  CHECK_THROWS(bounded.setHistory(0));
+}
+
+TEST_CASE("Bounded history reports instability as the full history")
+{
+  lotka_volterra::Simulation full{0.01, 50., 1., 1., 50., 1., 1.};
+  lotka_volterra::Simulation bounded{0.01, 50., 1., 1., 50., 1., 1.};
+  bounded.setHistory(1);
+
+  CHECK(full.evolveSteps(1000) == bounded.evolveSteps(1000));
+  CHECK(bounded.isUnstable());
+  CHECK(bounded.steps() == full.steps());
+  CHECK(bounded.maxRelDrift() == full.maxRelDrift());
+}
+
+TEST_CASE("Sinks receive every state")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 2., 3.};
+  sim.setHistory(10);
+  lotka_volterra::RunningStatistics stats;
+  sim.addSink(stats);
+
+  sim.evolveSteps(1000);
+  CHECK(stats.count() == sim.steps());
+  CHECK(stats.x().max >= stats.x().mean);
+  CHECK(stats.x().mean >= stats.x().min);
+  CHECK(stats.H().min == doctest::Approx(sim.H0()).epsilon(1e-2));
+
+  sim.removeSink(stats);
+  sim.evolve();
+  CHECK(stats.count() == sim.steps() - 1);
+
+  lotka_volterra::RunningStatistics empty;
+  CHECK_THROWS(empty.x());
+}
+
+TEST_CASE("A copy of a simulation has no sinks")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 2., 3.};
+  lotka_volterra::RunningStatistics stats;
+  sim.addSink(stats);
+  sim.evolveSteps(10);
+
+  lotka_volterra::Simulation copy{sim};
+  CHECK(copy.steps() == sim.steps());
+  copy.evolveSteps(10);
+  CHECK(stats.count() == 11);
+
+  lotka_volterra::Simulation other{0.001, 1., 1., 1., 1., 1., 1.};
+  lotka_volterra::RunningStatistics other_stats;
+  other.addSink(other_stats);
+  other = sim;
+  other.evolveSteps(10);
+  CHECK(other_stats.count() == 1);
+  CHECK(other.stateAt(15).x == copy.stateAt(15).x);
+
+  sim.evolve();
+  CHECK(stats.count() == 12); // the original still forwards its states
+  sim.removeSink(stats);
+}
+
+TEST_CASE("CSV sink streams the trajectory")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 2., 3.};
+  sim.setHistory(10);
+  {
+    io::CSVSink csv{"trajectory_stream.csv"};
+    sim.addSink(csv);
+    sim.evolveSteps(100);
+    sim.removeSink(csv);
+  }
+
+  std::ifstream file{"trajectory_stream.csv"};
+  std::size_t lines = 0;
+  for (std::string line; std::getline(file, line);) {
+    ++lines;
+  }
+  CHECK(lines == sim.steps() + 1);
+}
+
 TEST_CASE("CSV output works correctly")
 {
   lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1.};
@@ -202,6 +599,138 @@ TEST_CASE("CSV output works correctly")
   io::outputCSV(sim, "trajectory.csv");
 }
 
+TEST_CASE("CSV output writes the times of the output grid")
+{
+  lotka_volterra::Simulation sim{0.01, 1., 1., 1., 1., 2., 3., lotka_volterra::Integrator::DormandPrince};
+  std::vector<double> const times{0.5, 1.25, 4.};
+  sim.evolveGrid(times);
+  io::outputCSV(sim, "trajectory_grid.csv");
+
+  std::ifstream file{"trajectory_grid.csv"};
+  std::string line;
+  std::getline(file, line);
+  std::vector<double> read;
+  while (std::getline(file, line)) {
+    read.push_back(std::stod(line.substr(0, line.find(','))));
+  }
+  CHECK(read == std::vector<double>{0., 0.5, 1.25, 4.});
+}
+
+TEST_CASE("CSV output does not depend on the formatting threads")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 2., 3.};
+  sim.evolveSteps(1000);
+
+  auto read = [](std::string const& filename) {
+    std::ifstream file{filename};
+    return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  };
+
+  io::outputCSV(sim, "trajectory_serial.csv");
+  io::CSVOptions options;
+  options.threads    = 3;
+  options.chunk_rows = 7;
+  io::outputCSV(sim, "trajectory_parallel.csv", options);
+
+  std::string const serial = read("trajectory_serial.csv");
+  CHECK(serial == read("trajectory_parallel.csv"));
+  CHECK(serial.rfind("t,x,y,H\n0,2,3,", 0) == 0);
+
+  {
+    io::CSVSink csv{"trajectory_sink.csv"};
+    sim.addSink(csv);
+    sim.removeSink(csv); // the sink goes out of scope before the simulation
+  }
+  CHECK(serial == read("trajectory_sink.csv"));
+}
+
+TEST_CASE("Asynchronous CSV sink writes the same file as the synchronous writer")
+{
+  auto read = [](std::string const& filename) {
+    std::ifstream file{filename};
+    return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  };
+
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 2., 3.};
+  sim.setHistory(100);
+  io::CSVOptions options;
+  options.chunk_rows = 7; // many batches, the writer falls behind and consume() waits
+  {
+    io::AsyncCSVSink csv{"trajectory_async.csv", options};
+    sim.addSink(csv);
+    sim.evolveSteps(1000);
+    csv.flush();
+    std::string const flushed = read("trajectory_async.csv");
+    CHECK(std::count(flushed.begin(), flushed.end(), '\n') == 1002); // header and 1001 states
+
+    sim.evolveSteps(1000);
+    sim.removeSink(csv);
+  } // the destructor writes the last batches
+
+  lotka_volterra::Simulation full{0.001, 1., 1., 1., 1., 2., 3.};
+  full.evolveSteps(2000);
+  io::outputCSV(full, "trajectory_serial.csv");
+  CHECK(read("trajectory_async.csv") == read("trajectory_serial.csv"));
+
+  CHECK_THROWS(io::AsyncCSVSink{"missing_directory/trajectory.csv"});
+  options.chunk_rows = 0;
+  CHECK_THROWS(io::AsyncCSVSink{"trajectory_async.csv", options});
+}
+
+TEST_CASE("Asynchronous CSV sink reports write errors")
+{
+  if (!std::filesystem::exists("/dev/full")) {
+    return;
+  }
+  io::AsyncCSVSink csv{"/dev/full"}; // every write fails with ENOSPC
+  auto const fill = [&csv] {
+    for (std::size_t i = 0; i < 1000000; ++i) {
+      csv.consume(i, 0.001 * static_cast<double>(i), {1., 2., 3.});
+    }
+    csv.flush();
+  };
+  CHECK_THROWS_AS(fill(), std::runtime_error);
+  CHECK_THROWS_AS(csv.flush(), std::runtime_error);
+}
+
+TEST_CASE("CSV output selects columns and precision")
+{
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 2., 3.};
+  sim.evolveSteps(100);
+
+  io::CSVOptions options;
+  options.columns   = {io::Column::x, io::Column::H};
+  options.precision = 0;
+  io::outputCSV(sim, "trajectory_exact.csv", options);
+
+  std::ifstream file{"trajectory_exact.csv"};
+  std::string line;
+  std::getline(file, line);
+  CHECK(line == "x,H");
+  for (std::size_t i = 0; i < sim.steps(); ++i) { // shortest representation reads back exactly
+    REQUIRE(std::getline(file, line));
+    std::size_t const comma = line.find(',');
+    CHECK(std::stod(line.substr(0, comma)) == sim.xs()[i]);
+    CHECK(std::stod(line.substr(comma + 1)) == sim.Hs()[i]);
+  }
+
+  options.precision = 3;
+  io::outputCSV(sim, "trajectory_short.csv", options);
+  std::ifstream short_file{"trajectory_short.csv"};
+  std::getline(short_file, line);
+  std::getline(short_file, line);
+  CHECK(line == "2,3.21"); // H = 5 - ln 6
+
+  options.precision = 18;
+  CHECK_THROWS_AS(io::outputCSV(sim, "trajectory_bad.csv", options), std::invalid_argument);
+  options.precision = 6;
+  options.columns.clear();
+  CHECK_THROWS_AS(io::outputCSV(sim, "trajectory_bad.csv", options), std::invalid_argument);
+  options.columns = {io::Column::t};
+  options.threads = 0;
+  CHECK_THROWS_AS(io::outputCSV(sim, "trajectory_bad.csv", options), std::invalid_argument);
+}
+
 TEST_CASE("Simulation input creates a proper simulation")
 {
   CHECK_NOTHROW(io::inputSimulation({0.001, 1., 1., 1., 1., 1., 1.}));
@@ -0,0 +1,133 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "simulation.hpp"
+#include <algorithm>
+#include <thread>
+
+namespace {
+// the state of index i: every column is a function of i, so a reader can check what it sees
+void append_states(lotka_volterra::StateStore& store, std::size_t first, std::size_t n)
+{
+  std::vector<double> t(n), x(n), y(n), H(n);
+  for (std::size_t k = 0; k < n; ++k) {
+    double const i = static_cast<double>(first + k);
+    t[k]           = i;
+    x[k]           = 2. * i;
+    y[k]           = 3. * i;
+    H[k]           = -i;
+  }
+  store.append(t, x, y, H);
+}
+} // namespace
+
+TEST_CASE("State store keeps its states and every span while it grows")
+{
+  using lotka_volterra::StateStore;
+
+  StateStore store;
+  CHECK(store.size() == 0);
+  CHECK(store.xs().empty());
+  CHECK(store.capacity() == 0); // nothing reserved before the first state
+
+  store.push_back(0., 0., 0., 0.);
+  CHECK(store.capacity() == StateStore::range_states);
+  CHECK(store.bytes() == 4 * sizeof(double)); // the stored states, not the range
+  std::span<double const> const first = store.xs();
+  append_states(store, 1, 1000);
+  CHECK(store.xs().data() == first.data()); // appended in place
+
+  std::span<double const> const before = store.xs();
+  append_states(store, 1001, StateStore::range_states); // past the range: falls back to a new one
+  REQUIRE(store.size() == StateStore::range_states + 1001);
+  CHECK(store.capacity() == 2 * StateStore::range_states);
+  CHECK(store.bytes() == 4 * store.size() * sizeof(double));
+  CHECK(store.xs().data() != before.data());
+  CHECK(first[0] == 0.); // the old range keeps its states
+  CHECK(before[1000] == 2000.);
+  CHECK(std::equal(before.begin(), before.end(), store.xs().begin()));
+
+  bool same = true;
+  for (std::size_t i = 1; i < store.size(); ++i) {
+    double const v = static_cast<double>(i);
+    same           = same && store.ts()[i] == v && store.xs()[i] == 2. * v && store.ys()[i] == 3. * v && store.Hs()[i] == -v;
+  }
+  CHECK(same);
+
+  std::span<double const> const reserved = store.Hs();
+  store.reserve(3 * StateStore::range_states);
+  CHECK(store.capacity() == 3 * StateStore::range_states);
+  append_states(store, store.size(), StateStore::range_states); // within the reserved states
+  CHECK(store.capacity() == 3 * StateStore::range_states);
+  CHECK(reserved.back() == -static_cast<double>(reserved.size() - 1));
+
+  lotka_volterra::StateStore copy{store};
+  REQUIRE(copy.size() == store.size());
+  CHECK(copy.Hs().back() == store.Hs().back());
+  CHECK(copy.xs().data() != store.xs().data());
+
+  lotka_volterra::StateStore moved{std::move(copy)};
+  CHECK(moved.size() == store.size());
+  CHECK(copy.size() == 0);
+  copy = moved;
+  CHECK(copy.ys().back() == store.ys().back());
+
+  store.eraseFront(10);
+  CHECK(store.size() == moved.size() - 10);
+  CHECK(store.ts()[0] == 10.);
+  CHECK(store.xs().back() == moved.xs().back());
+  store.push_back(-1., -1., -1., -1.);
+  CHECK(store.Hs().back() == -1.);
+}
+
+TEST_CASE("State store is read by another thread while it grows")
+{
+  lotka_volterra::StateStore store;
+  std::size_t const total = 2 * lotka_volterra::StateStore::range_states + 12345; // two growths on the way
+  std::atomic<bool> consistent{true};
+
+  std::thread reader{[&] {
+    std::size_t seen = 0;
+    while (seen < total) {
+      std::span<double const> const xs = store.xs(); // every state up to the published length is complete
+      std::span<double const> const Hs = store.Hs();
+      if (!xs.empty() && (xs.back() != 2. * static_cast<double>(xs.size() - 1) || Hs[xs.size() - 1] != -static_cast<double>(xs.size() - 1))) {
+        consistent = false;
+      }
+      if (store.bytes() < 4 * xs.size() * sizeof(double)) { // the length only grows
+        consistent = false;
+      }
+      seen = xs.size();
+    }
+  }};
+  for (std::size_t first = 0; first < total; first += 1000) {
+    append_states(store, first, std::min<std::size_t>(1000, total - first));
+  }
+  reader.join();
+  CHECK(consistent);
+}
+
+TEST_CASE("Simulation columns stay valid while it evolves")
+{
+  std::size_t const range = lotka_volterra::StateStore::range_states;
+
+  lotka_volterra::Simulation sim{0.001, 1., 1., 1., 1., 1.5, 1.5, lotka_volterra::Integrator::RK4};
+  sim.reserve(1000);
+  sim.evolveSteps(100);
+  CHECK(sim.stateBytes() == 4 * 101 * sizeof(double)); // grows with the run, whatever was reserved
+  std::span<double const> const xs = sim.xs();
+  std::vector<double> const before(xs.begin(), xs.end());
+
+  sim.evolveSteps(range + 10); // past the first range
+  CHECK(std::equal(before.begin(), before.end(), xs.begin())); // the span taken before reads the same states
+  CHECK(std::equal(before.begin(), before.end(), sim.xs().begin()));
+
+  lotka_volterra::Simulation bounded{0.001, 1., 1., 1., 1., 1.5, 1.5};
+  bounded.setHistory(1000);
+  bounded.evolveSteps(2 * range);
+  CHECK(bounded.stateBytes() <= 4 * (2 * 1000 + bounded.chunkSize()) * sizeof(double)); // what it holds before an eviction
+
+  lotka_volterra::Simulation const copy = sim;
+  CHECK(copy.steps() == sim.steps());
+  CHECK(copy.stateAt(12345).y == sim.stateAt(12345).y);
+}
@@ -0,0 +1,204 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "binary.hpp"
+#include "numpy.hpp"
+#include "output.hpp"
+#include <filesystem>
+#include <random>
+#include <sstream>
+
+#include <zlib.h>
+#ifdef LV_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+std::string read_file(std::string const& filename)
+{
+  std::ifstream file{filename, std::ios::binary};
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+// every gzip member of the file, concatenated, as zcat does
+std::string gunzip(std::string const& bytes)
+{
+  std::string out;
+  z_stream z{};
+  REQUIRE(inflateInit2(&z, 15 + 16) == Z_OK);
+  z.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(bytes.data()));
+  z.avail_in = static_cast<uInt>(bytes.size());
+  char buffer[65536];
+  int result = Z_OK;
+  while (result != Z_STREAM_END) {
+    z.next_out  = reinterpret_cast<Bytef*>(buffer);
+    z.avail_out = sizeof buffer;
+    result      = inflate(&z, Z_NO_FLUSH);
+    REQUIRE((result == Z_OK || result == Z_STREAM_END));
+    out.append(buffer, sizeof buffer - z.avail_out);
+  }
+  CHECK(z.avail_in == 0);
+  inflateEnd(&z);
+  return out;
+}
+
+#ifdef LV_HAVE_ZSTD
+std::string unzstd(std::string const& bytes)
+{
+  std::string out;
+  ZSTD_DCtx* const context = ZSTD_createDCtx();
+  ZSTD_inBuffer input{bytes.data(), bytes.size(), 0};
+  std::string buffer(ZSTD_DStreamOutSize(), '\0');
+  while (input.pos < input.size) {
+    ZSTD_outBuffer output{buffer.data(), buffer.size(), 0};
+    std::size_t const result = ZSTD_decompressStream(context, &output, &input);
+    REQUIRE(!ZSTD_isError(result));
+    out.append(buffer.data(), output.pos);
+  }
+  ZSTD_freeDCtx(context);
+  return out;
+}
+#endif
+
+std::string random_text(std::size_t size)
+{
+  std::mt19937 rng{3};
+  std::string text;
+  while (text.size() < size) {
+    text += std::to_string(rng() % 1000) + ",";
+  }
+  return text;
+}
+} // namespace
+
+TEST_CASE("Gzip stream is a valid gzip file across blocks and flushes")
+{
+  std::string const text = random_text(3 * io::OutputStream::block_size + 12345);
+  for (int level : {0, 1, 9}) {
+    {
+      io::OutputStream stream{"test.gz", {io::Compression::Format::gzip, level}};
+      stream.write(text.data(), 1000);
+      stream.flush();
+      std::string const flushed = read_file("test.gz");
+      CHECK(flushed.compare(0, 2, "\x1f\x8b") == 0); // gzip magic number, on disk after the flush
+      stream.write(text.data() + 1000, text.size() - 1000); // crosses several blocks in one call
+      stream.finish();
+      CHECK_THROWS_AS(stream.write(text.data(), 1), std::logic_error);
+    }
+    std::string const compressed = read_file("test.gz");
+    CHECK(compressed.size() < text.size() / 2);
+    CHECK(gunzip(compressed) == text);
+  }
+
+  {
+    io::OutputStream stream{"test.gz", {io::Compression::Format::gzip, 0}};
+    stream.write(text.data(), 5000);
+  } // the destructor ends the stream
+  CHECK(gunzip(read_file("test.gz")) == text.substr(0, 5000));
+
+  CHECK_THROWS_AS((io::OutputStream{"test.gz", {io::Compression::Format::gzip, 10}}), std::invalid_argument);
+  CHECK_THROWS_AS((io::OutputStream{"test.gz", {io::Compression::Format::gzip, -1}}), std::invalid_argument);
+  CHECK_THROWS_AS((io::OutputStream{"missing_directory/test.gz", {io::Compression::Format::gzip, 0}}), std::runtime_error);
+  std::filesystem::remove("test.gz");
+}
+
+TEST_CASE("Output stream formats every block on its worker")
+{
+  // one block per record of 4 bytes, each written out as a line with its size
+  io::OutputStream::Formatter const lines = [](std::vector<char> const& block, std::vector<char>& out) {
+    std::string const line = std::string{block.begin(), block.end()} + " " + std::to_string(block.size()) + "\n";
+    out.insert(out.end(), line.begin(), line.end());
+  };
+  for (io::Compression::Format format : {io::Compression::Format::none, io::Compression::Format::gzip}) {
+    {
+      io::OutputStream stream{"test.out", {format, 0}, lines, 4};
+      stream.write("abcdefgh", 8);
+      stream.write("ijkl", 4);
+      stream.flush();
+      if (format == io::Compression::Format::none) {
+        CHECK(read_file("test.out") == "abcd 4\nefgh 4\nijkl 4\n 0\n");
+      }
+    } // the last, empty block is formatted too
+    std::string const bytes = read_file("test.out");
+    CHECK((format == io::Compression::Format::none ? bytes : gunzip(bytes)) == "abcd 4\nefgh 4\nijkl 4\n 0\n 0\n");
+  }
+
+  CHECK_THROWS_AS((io::OutputStream{"test.out", {}, lines, 0}), std::invalid_argument);
+  std::filesystem::remove("test.out");
+}
+
+TEST_CASE("Compressed exporters write the same bytes as the plain ones")
+{
+  lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7};
+  sim.evolveSteps(20000);
+
+  io::CSVOptions options;
+  io::outputCSV(sim, "test.csv", options);
+  options.compression = {io::Compression::Format::gzip, 6};
+  io::outputCSV(sim, "test.csv.gz", options);
+  CHECK(gunzip(read_file("test.csv.gz")) == read_file("test.csv"));
+  CHECK(std::filesystem::file_size("test.csv.gz") < std::filesystem::file_size("test.csv") / 2);
+
+  {
+    io::AsyncCSVSink csv{"test_async.csv.gz", options};
+    sim.addSink(csv);
+    sim.removeSink(csv);
+  }
+  CHECK(gunzip(read_file("test_async.csv.gz")) == read_file("test.csv"));
+  {
+    io::CSVSink csv{"test_sink.csv.gz", options};
+    sim.addSink(csv);
+    sim.removeSink(csv);
+  }
+  CHECK(gunzip(read_file("test_sink.csv.gz")) == read_file("test.csv"));
+
+  io::Compression const gzip{io::Compression::Format::gzip, 1};
+  io::outputBinary(sim, "test.lvt");
+  io::outputBinary(sim, "test.lvt.gz", gzip);
+  CHECK(gunzip(read_file("test.lvt.gz")) == read_file("test.lvt"));
+
+  io::outputCompressed(sim, "test.lvz");
+  io::outputCompressed(sim, "test.lvz.gz", gzip);
+  CHECK(gunzip(read_file("test.lvz.gz")) == read_file("test.lvz"));
+
+  io::outputNPY(sim, "test.npy");
+  io::outputNPY(sim, "test.npy.gz", gzip);
+  CHECK(gunzip(read_file("test.npy.gz")) == read_file("test.npy"));
+
+  for (char const* name : {"test.csv", "test.csv.gz", "test_async.csv.gz", "test_sink.csv.gz", "test.lvt", "test.lvt.gz", "test.lvz",
+                           "test.lvz.gz", "test.npy", "test.npy.gz"}) {
+    std::filesystem::remove(name);
+  }
+}
+
+TEST_CASE("Zstd stream is available only if zstd was found")
+{
+  io::Compression const zstd{io::Compression::Format::zstd, 0};
+#ifdef LV_HAVE_ZSTD
+  REQUIRE(io::isAvailable(io::Compression::Format::zstd));
+  lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7};
+  sim.evolveSteps(20000);
+
+  io::CSVOptions options;
+  io::outputCSV(sim, "test.csv", options);
+  for (int level : {0, 1, 19}) {
+    options.compression = {io::Compression::Format::zstd, level};
+    io::outputCSV(sim, "test.csv.zst", options);
+    CHECK(unzstd(read_file("test.csv.zst")) == read_file("test.csv"));
+  }
+  io::outputBinary(sim, "test.lvt");
+  io::outputBinary(sim, "test.lvt.zst", zstd);
+  CHECK(unzstd(read_file("test.lvt.zst")) == read_file("test.lvt"));
+  CHECK_THROWS_AS((io::OutputStream{"test.zst", {io::Compression::Format::zstd, 20}}), std::invalid_argument);
+
+  for (char const* name : {"test.csv", "test.csv.zst", "test.lvt", "test.lvt.zst"}) {
+    std::filesystem::remove(name);
+  }
+#else
+  CHECK(!io::isAvailable(io::Compression::Format::zstd));
+  CHECK_THROWS_AS(io::OutputStream("test.zst", zstd), std::invalid_argument);
+#endif
+  CHECK(io::isAvailable(io::Compression::Format::gzip));
+}
@@ -0,0 +1,114 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+#include "output.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+std::size_t count_events(std::vector<lotka_volterra::TraceEvent> const& events, std::string const& name)
+{
+  return static_cast<std::size_t>(std::count_if(events.begin(), events.end(), [&name](auto const& event) { return event.name == name; }));
+}
+} // namespace
+
+TEST_CASE("Trace records scopes and counters per thread between start and stop")
+{
+  using lotka_volterra::Trace;
+  using lotka_volterra::TraceScope;
+
+  Trace::start();
+  { TraceScope const dropped_by_restart{"old"}; }
+  Trace::start();
+  {
+    TraceScope const outer{"outer"};
+    {
+      TraceScope const inner{"inner"};
+      Trace::counter("count", 42.);
+    }
+    std::jthread other{[] {
+      TraceScope const scope{"other"};
+    }};
+  }
+  Trace::stop();
+  { TraceScope const ignored{"ignored"}; }
+  Trace::counter("ignored", 1.);
+
+  std::vector<lotka_volterra::TraceEvent> const events = Trace::events();
+  REQUIRE(events.size() == 4);
+  CHECK(count_events(events, "old") == 0);
+  CHECK(count_events(events, "ignored") == 0);
+
+  auto const find = [&events](std::string const& name) {
+    return *std::find_if(events.begin(), events.end(), [&name](auto const& event) { return event.name == name; });
+  };
+  auto const outer = find("outer");
+  auto const inner = find("inner");
+  auto const other = find("other");
+  auto const count = find("count");
+  CHECK(outer.phase == 'X');
+  CHECK(inner.start >= outer.start);
+  CHECK(inner.start + inner.duration <= outer.start + outer.duration); // nested
+  CHECK(count.phase == 'C');
+  CHECK(count.value == 42.);
+  CHECK(count.start >= inner.start);
+  CHECK(inner.thread == outer.thread);
+  CHECK(other.thread != outer.thread);
+  CHECK(Trace::dropped() == 0);
+
+  std::string const filename = "trace_test.json";
+  io::outputTrace(filename);
+  std::ifstream file{filename};
+  std::ostringstream content;
+  content << file.rdbuf();
+  std::string const json = content.str();
+  CHECK(json.starts_with("{\"traceEvents\":[\n"));
+  CHECK(json.ends_with("],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":\"0\"}}\n"));
+  CHECK(json.find("{\"name\":\"outer\",\"cat\":\"lotka_volterra\",\"ph\":\"X\",\"ts\":") != std::string::npos);
+  CHECK(json.find("\"ph\":\"C\",") != std::string::npos);
+  CHECK(json.find(",\"args\":{\"value\":42}}") != std::string::npos);
+  CHECK(std::count(json.begin(), json.end(), '\n') == 6); // one line per event, and the first and last
+  std::filesystem::remove(filename);
+}
+
+TEST_CASE("Trace drops the events past a full buffer")
+{
+  using lotka_volterra::Trace;
+
+  Trace::start();
+  for (std::size_t i = 0; i < Trace::max_events + 10; ++i) {
+    Trace::counter("fill", static_cast<double>(i));
+  }
+  Trace::stop();
+  CHECK(Trace::events().size() == Trace::max_events);
+  CHECK(Trace::dropped() == 10);
+
+  Trace::start(); // a new trace starts empty
+  Trace::stop();
+  CHECK(Trace::events().empty());
+  CHECK(Trace::dropped() == 0);
+}
+
+#ifdef LV_TRACE
+TEST_CASE("Trace points cover the integration")
+{
+  using lotka_volterra::Trace;
+
+  lotka_volterra::Simulation sim{0.001, 1.1, 0.9, 1.2, 0.8, 1.5, 0.7};
+  sim.setChunkSize(1000);
+  Trace::start();
+  sim.evolveSteps(5000);
+  sim.evolve();
+  Trace::stop();
+
+  std::vector<lotka_volterra::TraceEvent> const events = Trace::events();
+  CHECK(count_events(events, "Simulation::evolve") == 6); // one per chunk, one for the single step
+  CHECK(count_events(events, "Simulation::compute_H") == 6);
+  CHECK(count_events(events, "Simulation::push_states") == 5); // a single step stores its state directly
+  CHECK(count_events(events, "states") == 5);
+}
+#endif